@@ -0,0 +1,117 @@
+// Wake-up jitter benchmark for ThreadManager
+//
+// Runs a periodic 1 ms loop (the shape of the LED/servo control path) twice:
+// once as a plain thread and once pinned to a CPU with SCHED_FIFO priority,
+// while optional busy threads load the system. Prints the wake-up latency
+// distribution of both runs.
+//
+// Usage: thread_jitter_bench [cpu_core] [rt_priority] [iterations] [load_threads]
+// Best results on the Pi with the core isolated: add isolcpus=3 to cmdline.txt
+// and run as root (or with CAP_SYS_NICE) so SCHED_FIFO can be applied.
+
+#include "logger.hpp"
+#include "thread_manager.hpp"
+#include <time.h>
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+Logger logger;
+
+static constexpr long PERIOD_NS = 1000000;  // 1 ms control period
+
+static long diffNs(const timespec& a, const timespec& b) {
+    return (a.tv_sec - b.tv_sec) * 1000000000L + (a.tv_nsec - b.tv_nsec);
+}
+
+// Sleep until each period boundary and record how late we woke up
+static void periodicLoop(int iterations, std::vector<long>& latencies) {
+    latencies.reserve(iterations);
+
+    timespec next;
+    clock_gettime(CLOCK_MONOTONIC, &next);
+
+    for (int i = 0; i < iterations; ++i) {
+        next.tv_nsec += PERIOD_NS;
+        while (next.tv_nsec >= 1000000000L) {
+            next.tv_nsec -= 1000000000L;
+            next.tv_sec++;
+        }
+
+        clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &next, nullptr);
+
+        timespec now;
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        latencies.push_back(diffNs(now, next));
+    }
+}
+
+static void busyLoop(std::atomic<bool>& stop) {
+    volatile unsigned long counter = 0;
+    while (!stop.load(std::memory_order_relaxed)) {
+        counter = counter + 1;
+    }
+}
+
+static void printReport(const std::string& label, std::vector<long> latencies) {
+    std::sort(latencies.begin(), latencies.end());
+
+    auto percentile = [&](double p) {
+        size_t index = static_cast<size_t>(p * (latencies.size() - 1));
+        return latencies[index] / 1000.0;
+    };
+
+    std::printf("%-10s min %8.1f  p50 %8.1f  p99 %8.1f  p99.9 %8.1f  max %8.1f  (us)\n",
+                label.c_str(),
+                latencies.front() / 1000.0,
+                percentile(0.50),
+                percentile(0.99),
+                percentile(0.999),
+                latencies.back() / 1000.0);
+}
+
+static std::vector<long> runOnce(const ThreadOptions& options, int iterations, int loadThreads) {
+    std::atomic<bool> stopLoad(false);
+    std::vector<long> latencies;
+
+    ThreadManager loadManager;
+    for (int i = 0; i < loadThreads; ++i) {
+        loadManager.spawn({.name = "bench-load" + std::to_string(i)}, busyLoop, std::ref(stopLoad));
+    }
+
+    {
+        ThreadManager manager;
+        manager.spawn(options, periodicLoop, iterations, std::ref(latencies));
+        manager.joinAll();
+    }
+
+    stopLoad.store(true);
+    loadManager.joinAll();
+    return latencies;
+}
+
+int main(int argc, char* argv[]) {
+    int cpuCore      = argc > 1 ? std::atoi(argv[1]) : 3;
+    int priority     = argc > 2 ? std::atoi(argv[2]) : 80;
+    int iterations   = argc > 3 ? std::atoi(argv[3]) : 10000;
+    int loadThreads  = argc > 4 ? std::atoi(argv[4]) : static_cast<int>(std::thread::hardware_concurrency());
+
+    if (iterations <= 0) {
+        std::fprintf(stderr, "iterations must be positive\n");
+        return 1;
+    }
+
+    std::printf("Period 1 ms, %d iterations, %d load threads\n", iterations, loadThreads);
+
+    ThreadOptions baseline{.name = "bench-default"};
+    printReport("default", runOnce(baseline, iterations, loadThreads));
+
+    ThreadOptions tuned{.name = "bench-rt", .cpuCore = cpuCore, .realtimePriority = priority};
+    printReport("cpu" + std::to_string(cpuCore) + "/rt" + std::to_string(priority),
+                runOnce(tuned, iterations, loadThreads));
+
+    return 0;
+}
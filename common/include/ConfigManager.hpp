@@ -5,6 +5,9 @@
 #include <stdio.h>
 #include <iostream>
 #include <fstream>
+#include <string>
+#include <vector>
+#include <map>
 
 struct MQTTConfig {
     std::string brokerAddress;
@@ -13,6 +16,31 @@ struct MQTTConfig {
     std::string topicStatus;
     int keepAliveInterval;
     int timeout;
+    bool cleanSession = false;              // false = broker keeps subscriptions and QoS-1 state
+    std::string persistenceDir;             // Paho file persistence for in-flight messages, empty = in memory
+    int reconnectMinDelayMs = 250;          // First reconnect backoff
+    int reconnectMaxDelayMs = 30000;        // Backoff ceiling
+};
+
+// One aggregation window; hopMs == lengthMs makes it tumbling
+struct WindowSpec {
+    std::string name;
+    int lengthMs;
+    int hopMs;
+};
+
+struct AggregationConfig {
+    bool enabled = false;
+    std::string topic;                      // Where window summaries are published
+    std::vector<std::string> fields;        // Numeric payload fields to summarize
+    std::vector<WindowSpec> windows;
+};
+
+struct ChangeDetectionConfig {
+    bool enabled = false;
+    int heartbeatIntervalMs = 30000;            // Forward unchanged state this often, 0 = never
+    std::map<std::string, double> deadbands;    // Numeric field -> smallest change that counts
+    std::vector<std::string> ignoredFields;     // Always-changing fields (uptime, timestamp)
 };
 
 struct AppConfig {
@@ -0,0 +1,87 @@
+#ifndef CHANGE_DETECTOR_HPP
+#define CHANGE_DETECTOR_HPP
+
+#include <json/json.h>
+#include <string>
+#include <mutex>
+#include <chrono>
+#include <cstdint>
+#include <unordered_map>
+#include <unordered_set>
+#include "ConfigManager.hpp"
+
+// What to do with an incoming message
+enum class ChangeVerdict {
+    Changed,        // Forward the full message
+    Heartbeat,      // Unchanged, but forward a cheap heartbeat so consumers know it's alive
+    Suppressed      // Unchanged, drop it
+};
+
+struct ChangeStats {
+    uint64_t received = 0;
+    uint64_t forwarded = 0;         // Changed messages forwarded in full
+    uint64_t heartbeats = 0;
+    uint64_t suppressedRaw = 0;     // Dropped by the payload hash, before parsing
+    uint64_t suppressedFields = 0;  // Dropped by the per-field deadband check
+
+    // Fraction of received messages that were not forwarded in full
+    double suppressionRatio() const {
+        return received ? static_cast<double>(received - forwarded) / received : 0.0;
+    }
+};
+
+// Per-device change detection for status payloads, run right after ingest.
+// Stage 1 hashes the raw payload per topic and device so byte-identical
+// repeats are dropped before they are parsed; the device id is read from
+// the raw text, so devices sharing a topic don't reset each other. Stage 2
+// compares the parsed fields against the last forwarded values, treating
+// numeric changes within a field's deadband as unchanged. Command replies
+// ("ok" / "error") always pass. Thread-safe.
+class ChangeDetector {
+public:
+    explicit ChangeDetector(const ChangeDetectionConfig& config);
+
+    // First "device_id" string in a raw payload, read without parsing;
+    // empty if there is none or it contains escapes
+    static std::string rawDeviceId(const std::string& payload);
+
+    // Key for both stages: topic plus the device id, or the topic alone
+    static std::string payloadKey(const std::string& topic, const std::string& deviceId);
+
+    // Stage 1: verdict for a raw payload, before parsing; key from payloadKey()
+    ChangeVerdict checkPayload(const std::string& key, const std::string& payload);
+
+    // Stage 2: verdict for a parsed message that passed stage 1 as Changed
+    ChangeVerdict checkFields(const std::string& topic, const Json::Value& message);
+
+    ChangeStats getStats() const;
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    struct PayloadState {
+        size_t hash = 0;
+        Clock::time_point lastForwarded;
+    };
+
+    struct DeviceState {
+        std::unordered_map<std::string, Json::Value> fields;   // Last forwarded value per field
+        Clock::time_point lastForwarded;
+    };
+
+    // Heartbeat if the interval elapsed since the key last forwarded anything
+    ChangeVerdict unchangedVerdictLocked(Clock::time_point& lastForwarded, Clock::time_point now);
+
+    // True if value differs from previous by more than the field's deadband
+    bool fieldChanged(const std::string& field, const Json::Value& previous, const Json::Value& value) const;
+
+    ChangeDetectionConfig config_;
+    std::unordered_set<std::string> ignoredFields_;
+
+    mutable std::mutex mutex_;                                  // Protects everything below
+    std::unordered_map<std::string, PayloadState> payloads_;    // Topic + device id -> last payload
+    std::unordered_map<std::string, DeviceState> devices_;      // Topic + device id -> last fields
+    ChangeStats stats_;
+};
+
+#endif // CHANGE_DETECTOR_HPP
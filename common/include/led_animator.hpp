@@ -0,0 +1,184 @@
+#ifndef LED_ANIMATOR_HPP
+#define LED_ANIMATOR_HPP
+
+#include <json/json.h>
+#include <string>
+#include <vector>
+#include <deque>
+#include <unordered_map>
+#include <functional>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <optional>
+#include <chrono>
+#include <cstdint>
+#include "thread_manager.hpp"
+
+// One rendered output state of a device
+struct LedFrame {
+    int r = 0;
+    int g = 0;
+    int b = 0;
+    int servoAngle = -1;    // -1 = leave the servo alone
+
+    bool operator==(const LedFrame& other) const = default;
+};
+
+// Frame reached at atMs after the animation starts
+struct Keyframe {
+    int64_t atMs;
+    LedFrame frame;
+};
+
+enum class Easing {
+    Step,       // Jump at each keyframe
+    Linear,
+    EaseInOut   // Smoothstep, gentler start and end
+};
+
+// Timeline of keyframes, interpolated between neighbours
+class Animation {
+public:
+    Animation(std::vector<Keyframe> keyframes, Easing easing = Easing::Linear, bool loop = false);
+
+    // Fade from one color to another
+    static Animation fade(const LedFrame& from, const LedFrame& to, int64_t durationMs,
+                          Easing easing = Easing::EaseInOut);
+
+    // Hold each frame for stepMs, optionally forever
+    static Animation sequence(const std::vector<LedFrame>& frames, int64_t stepMs, bool loop = true);
+
+    // Frame at elapsedMs after start
+    LedFrame sample(int64_t elapsedMs) const;
+
+    // True once a non-looping animation has reached its last keyframe
+    bool finished(int64_t elapsedMs) const;
+
+    int64_t durationMs() const;
+
+private:
+    std::vector<Keyframe> keyframes_;   // Sorted by atMs
+    Easing easing_;
+    bool loop_;
+};
+
+// Holds only the newest value; storing over an unread value replaces it
+// so a slow consumer never works through a backlog of stale frames.
+template<typename T>
+class LatestValueSlot {
+public:
+    // Returns true if an unread value was overwritten (a dropped frame)
+    bool store(T value) {
+        bool dropped = value_.has_value();
+        value_ = std::move(value);
+        return dropped;
+    }
+
+    std::optional<T> take() {
+        std::optional<T> value = std::move(value_);
+        value_.reset();
+        return value;
+    }
+
+    bool hasValue() const { return value_.has_value(); }
+
+private:
+    std::optional<T> value_;
+};
+
+struct AnimatorConfig {
+    int frameRateHz = 60;
+    ThreadOptions renderThread{.name = "led-render"};
+    ThreadOptions sendThread{.name = "led-send"};
+};
+
+// Frame pacing and delivery counters
+struct AnimatorStats {
+    uint64_t ticks = 0;             // Render ticks executed
+    uint64_t overruns = 0;          // Ticks that started a full period late
+    uint64_t framesRendered = 0;    // Frames that differed from the previous one
+    uint64_t framesSent = 0;
+    uint64_t framesDropped = 0;     // Overwritten in a slot before the sender got to them
+    double avgJitterUs = 0.0;       // Mean |tick interval - period|
+    double maxJitterUs = 0.0;
+};
+
+// Plays animations on many devices.
+// A render thread samples every active animation at the configured frame
+// rate and stores the result in that device's LatestValueSlot; it sleeps
+// while no animation is playing. A send
+// thread drains the slots that have a value, converts frames to
+// led_color / servo_angle commands and hands them to the sender.
+class LedAnimator {
+public:
+    // Called on the send thread with the device id and a command to publish
+    using Sender = std::function<bool(const std::string& deviceId, const Json::Value& command)>;
+
+    LedAnimator(const AnimatorConfig& config, Sender sender);
+    ~LedAnimator();
+
+    LedAnimator(const LedAnimator&) = delete;
+    LedAnimator& operator=(const LedAnimator&) = delete;
+
+    // Start the render and send threads
+    void start();
+
+    // Stop and join both threads
+    void stop();
+
+    // Replace whatever the device is playing
+    void play(const std::string& deviceId, Animation animation);
+
+    // Stop the device's animation, leaving it on its last frame
+    void cancel(const std::string& deviceId);
+
+    // Last frame rendered for the device (black if none yet)
+    LedFrame currentFrame(const std::string& deviceId) const;
+
+    size_t activeCount() const;
+
+    AnimatorStats getStats() const;
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    struct Playback {
+        Animation animation;
+        Clock::time_point startedAt;
+    };
+
+    struct Device {
+        std::optional<Playback> playback;
+        LedFrame lastRendered;
+        bool rendered = false;
+        LatestValueSlot<LedFrame> slot;
+        std::optional<LedFrame> lastSent;
+    };
+
+    void renderLoop();
+    void sendLoop();
+
+    // Render one tick for every playing device (caller holds the lock)
+    void renderTickLocked(Clock::time_point now);
+
+    // True if any device has an animation (caller holds the lock)
+    bool anyPlayingLocked() const;
+
+    // Build the commands needed to move a device from lastSent to frame
+    static std::vector<Json::Value> commandsFor(const LedFrame& frame, const std::optional<LedFrame>& lastSent);
+
+    AnimatorConfig config_;
+    Sender sender_;
+    ThreadManager threads_;
+    std::atomic<bool> running_{false};
+
+    mutable std::mutex mutex_;                          // Protects everything below
+    std::condition_variable renderCv_;                  // Wakes the idle render thread
+    std::condition_variable sendCv_;                    // Wakes the send thread
+    std::unordered_map<std::string, Device> devices_;
+    std::deque<std::string> ready_;                     // Devices whose slot went from empty to full
+    AnimatorStats stats_;
+};
+
+#endif // LED_ANIMATOR_HPP
@@ -7,13 +7,58 @@
 #include <string>
 #include <functional>
 #include <memory>
-#include "tread_manager.hpp"
+#include <mutex>
+#include <condition_variable>
+#include <vector>
+#include <unordered_map>
+#include <chrono>
+#include <cstdint>
+#include "priority_lane_queue.hpp"
+#include "change_detector.hpp"
+#include "topic_router.hpp"
+#include "thread_manager.hpp"
 #include "ConfigManager.hpp"
 
+// Lanes of the inbound message queue, in priority order
+enum class MessageLane : size_t {
+    Control = 0,    // Command acknowledgements ("ok" / "error" replies)
+    Telemetry = 1   // Status and sensor samples
+};
+
+// A parsed message together with the topic it arrived on
+struct InboundMessage {
+    std::string topic;
+    Json::Value payload;
+};
+
+using MessageQueue = PriorityLaneQueue<InboundMessage>;
+
+// Receives parsed inbound messages on Paho's callback thread
+using SampleSink = std::function<void(const std::string& topic, const Json::Value& message)>;
+
+// Choose the lane for an inbound message by message class, then by topic
+MessageLane selectMessageLane(const std::string& topic, const Json::Value& message);
+
+// Time-to-recover counters for broker outages
+struct ReconnectStats {
+    uint64_t outages = 0;           // Connection losses seen
+    uint64_t recoveries = 0;        // Successful reconnects
+    uint64_t attempts = 0;          // Reconnect attempts made
+    double lastRecoveryMs = 0.0;    // Loss -> connected, most recent outage
+    double maxRecoveryMs = 0.0;
+    double avgRecoveryMs = 0.0;
+    uint64_t resubscribeFailures = 0;   // Batched SUBSCRIBEs that failed or were rejected
+};
+
+class MQTTClient;
+
 // Callback class to handle MQTT events
 class MQTTCallback : public virtual mqtt::callback {
 public:
-    MQTTCallback(ThreadSafeQueue<Json::Value>* messageQueue);
+    MQTTCallback(MessageQueue* messageQueue, MQTTClient* owner);
+    
+    // Called when the connection (or a reconnection) succeeds
+    void connected(const std::string& cause) override;
     
     // Called when a message arrives
     void message_arrived(mqtt::const_message_ptr msg) override;
@@ -24,17 +69,50 @@ public:
     // Called when delivery is complete
     void delivery_complete(mqtt::delivery_token_ptr tok) override;
     
+    // Filter unchanged messages at ingest (nullptr disables); set before connecting
+    void setChangeDetector(ChangeDetector* changeDetector);
+    
+    // Drop messages on topics matching filter before logging or parsing them
+    void ignoreTopic(const std::string& filter);
+    
+    // Receive every parsed message, including those change detection drops
+    void setSampleSink(SampleSink sink);
+    
 private:
-    ThreadSafeQueue<Json::Value>* messageQueue_;
+    // Forward a minimal "still alive" message in place of an unchanged one
+    void pushHeartbeat(const std::string& topic, const Json::Value& deviceId);
+    
+    MessageQueue* messageQueue_;
+    MQTTClient* owner_;
+    ChangeDetector* changeDetector_ = nullptr;
+    TopicRouter ignoredTopics_;     // Filters only; matched topics are dropped
+    SampleSink sampleSink_;
+    
+    // Last parsed message per stage-1 key, replayed to the sink for
+    // byte-identical repeats that are never parsed
+    std::unordered_map<std::string, Json::Value> lastSamples_;
+};
+
+// Reports the result of a batched SUBSCRIBE back to the client
+class SubscribeListener : public virtual mqtt::iaction_listener {
+public:
+    explicit SubscribeListener(MQTTClient* owner);
+    
+    void on_success(const mqtt::token& tok) override;
+    void on_failure(const mqtt::token& tok) override;
+    
+private:
+    MQTTClient* owner_;
 };
 
 // MQTT Client wrapper class
 class MQTTClient {
 public:
-    MQTTClient(const MQTTConfig& config, ThreadSafeQueue<Json::Value>* messageQueue);
+    MQTTClient(const MQTTConfig& config, MessageQueue* messageQueue);
     ~MQTTClient();
     
     // Connect to the MQTT broker
+    // Fails if the subscriptions registered so far are not granted
     bool connect();
     
     // Disconnect from the broker
@@ -43,23 +121,93 @@ public:
     // Check if connected
     bool isConnected() const;
     
+    // Skip unchanged inbound messages (nullptr disables); call before connect()
+    void setChangeDetector(ChangeDetector* changeDetector);
+    
+    // Drop inbound messages matching a topic filter at ingest, e.g. our own
+    // publications echoed back by a wildcard subscription; call before connect()
+    void ignoreInbound(const std::string& filter);
+    
+    // Hand every parsed inbound message to sink on Paho's callback thread,
+    // before change detection, so consumers such as the aggregator see the
+    // full sample rate; call before connect()
+    void setSampleSink(SampleSink sink);
+    
     // Subscribe to a topic
+    // The subscription is remembered and re-established after every reconnect;
+    // if called before connect() it is sent with the connection's batch
     bool subscribe(const std::string& topic, int qos = 1);
     
     // Publish a JSON message to a topic
-    bool publishJSON(const std::string& topic, const Json::Value& message, int qos = 1);
+    // verbose = false logs only publish errors, not progress or disconnected state
+    // (for high-rate streams such as animations)
+    bool publishJSON(const std::string& topic, const Json::Value& message, int qos = 1, bool verbose = true);
+    
+    // Publish a JSON message without waiting for the broker's acknowledgement
+    // For latency-sensitive threads; returns false only if it couldn't be queued
+    bool publishJSONAsync(const std::string& topic, const Json::Value& message, int qos = 1);
     
     // Publish a string message to a topic
-    bool publishString(const std::string& topic, const std::string& payload, int qos = 1);
+    bool publishString(const std::string& topic, const std::string& payload, int qos = 1, bool verbose = true);
     
     // Get configuration
     const MQTTConfig& getConfig() const { return config_; }
     
+    // Get outage and time-to-recover counters
+    ReconnectStats getReconnectStats() const;
+    
 private:
+    friend class MQTTCallback;
+    friend class SubscribeListener;
+    
+    using Clock = std::chrono::steady_clock;
+    
+    struct Subscription {
+        std::string topic;
+        int qos;
+    };
+    
+    enum class SubscribeState {
+        Idle,       // No batched SUBSCRIBE sent since connect() started
+        Pending,
+        Granted,
+        Failed
+    };
+    
+    // Called from MQTTCallback on Paho's callback thread
+    void handleConnected(const std::string& cause);
+    void handleConnectionLost();
+    
+    // Send all remembered subscriptions in one SUBSCRIBE packet
+    void resubscribeAll();
+    
+    // Called from SubscribeListener with the SUBACK outcome
+    void handleSubscribeResult(bool granted, const std::string& detail);
+    
+    // True if the token succeeded and no SUBACK return code is a failure (>= 0x80)
+    static bool subscriptionsGranted(const mqtt::token& tok);
+    
+    // Reconnect thread: retries with jittered exponential backoff after a loss
+    void reconnectLoop();
+    void stopReconnectThread();
+    
     MQTTConfig config_;
+    mqtt::connect_options connOpts_;
     std::unique_ptr<mqtt::async_client> client_;
     std::unique_ptr<MQTTCallback> callback_;
-    ThreadSafeQueue<Json::Value>* messageQueue_;
+    std::unique_ptr<SubscribeListener> subscribeListener_;
+    MessageQueue* messageQueue_;
+    ThreadManager threads_;                         // Owns the reconnect thread
+    
+    mutable std::mutex stateMutex_;                 // Protects everything below
+    std::condition_variable reconnectCv_;           // Wakes the reconnect thread
+    std::condition_variable subscribeCv_;           // Signals SUBACK results to connect()
+    std::vector<Subscription> subscriptions_;
+    bool connectionLost_ = false;
+    bool stopping_ = false;
+    SubscribeState subscribeState_ = SubscribeState::Idle;
+    Clock::time_point lostAt_;
+    ReconnectStats reconnectStats_;
 };
 
 #endif // MQTT_CLIENT_HPP
@@ -0,0 +1,206 @@
+#ifndef PRIORITY_LANE_QUEUE_HPP
+#define PRIORITY_LANE_QUEUE_HPP
+
+#include <deque>
+#include <vector>
+#include <string>
+#include <mutex>
+#include <condition_variable>
+#include <optional>
+#include <chrono>
+#include <cstdint>
+#include <algorithm>
+#include <stdexcept>
+
+// How the next lane is chosen when several lanes have items
+enum class LanePolicy {
+    Strict,     // Always serve the highest-priority non-empty lane (lower lanes may starve)
+    Weighted    // Weighted round-robin: lane i gets weight[i] pops per round while backlogged
+};
+
+// Configuration of one lane, lane 0 has the highest priority
+struct LaneConfig {
+    std::string name;
+    unsigned weight = 1;
+};
+
+// Snapshot of per-lane counters
+struct LaneStats {
+    std::string name;
+    size_t depth = 0;               // Items currently queued
+    size_t maxDepth = 0;            // Highest depth seen
+    uint64_t pushed = 0;
+    uint64_t popped = 0;
+    double avgLatencyUs = 0.0;      // Mean time from push to pop
+    double maxLatencyUs = 0.0;      // Worst time from push to pop
+};
+
+// Thread-safe multi-lane queue
+// push() takes a lane index so control traffic (command replies) is not
+// stuck behind bulk telemetry.
+template<typename T>
+class PriorityLaneQueue {
+public:
+    explicit PriorityLaneQueue(std::vector<LaneConfig> lanes, LanePolicy policy = LanePolicy::Weighted)
+        : policy_(policy) {
+        if (lanes.empty()) {
+            throw std::invalid_argument("PriorityLaneQueue needs at least one lane");
+        }
+        for (auto& config : lanes) {
+            Lane lane;
+            lane.config = std::move(config);
+            lane.config.weight = std::max(1u, lane.config.weight);
+            lane.credits = lane.config.weight;
+            lanes_.push_back(std::move(lane));
+        }
+    }
+
+    // Delete copy constructor and assignment (queues shouldn't be copied)
+    PriorityLaneQueue(const PriorityLaneQueue&) = delete;
+    PriorityLaneQueue& operator=(const PriorityLaneQueue&) = delete;
+
+    // Push an item to the given lane (thread-safe)
+    // Out-of-range lanes fall back to the lowest-priority lane
+    void push(T value, size_t lane) {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            Lane& target = lanes_[std::min(lane, lanes_.size() - 1)];
+            target.items.push_back({std::move(value), Clock::now()});
+            target.pushed++;
+            target.maxDepth = std::max(target.maxDepth, target.items.size());
+            totalSize_++;
+        } // Lock released here
+
+        condVar_.notify_one();
+    }
+
+    // Try to pop an item (non-blocking)
+    // Returns std::nullopt if all lanes are empty
+    std::optional<T> tryPop() {
+        std::lock_guard<std::mutex> lock(mutex_);
+
+        if (totalSize_ == 0) {
+            return std::nullopt;
+        }
+        return popLocked();
+    }
+
+    // Pop an item (blocking)
+    // Waits until any lane has an item
+    T waitAndPop() {
+        std::unique_lock<std::mutex> lock(mutex_);
+        condVar_.wait(lock, [this] { return totalSize_ != 0; });
+        return popLocked();
+    }
+
+    // Pop an item, waiting at most timeout for one to arrive
+    // Returns std::nullopt if all lanes are still empty after the timeout
+    template<typename Rep, typename Period>
+    std::optional<T> waitAndPop(std::chrono::duration<Rep, Period> timeout) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        if (!condVar_.wait_for(lock, timeout, [this] { return totalSize_ != 0; })) {
+            return std::nullopt;
+        }
+        return popLocked();
+    }
+
+    // Check if all lanes are empty (snapshot, may change immediately)
+    bool empty() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return totalSize_ == 0;
+    }
+
+    // Get total queued items across lanes (snapshot, may change immediately)
+    size_t size() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return totalSize_;
+    }
+
+    // Get per-lane depth and latency counters
+    std::vector<LaneStats> stats() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+
+        std::vector<LaneStats> result;
+        for (const auto& lane : lanes_) {
+            LaneStats s;
+            s.name = lane.config.name;
+            s.depth = lane.items.size();
+            s.maxDepth = lane.maxDepth;
+            s.pushed = lane.pushed;
+            s.popped = lane.popped;
+            s.avgLatencyUs = lane.popped ? lane.totalLatencyUs / lane.popped : 0.0;
+            s.maxLatencyUs = lane.maxLatencyUs;
+            result.push_back(s);
+        }
+        return result;
+    }
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    struct Entry {
+        T value;
+        Clock::time_point enqueued;
+    };
+
+    struct Lane {
+        LaneConfig config;
+        std::deque<Entry> items;
+        unsigned credits = 0;           // Pops left in the current weighted round
+        size_t maxDepth = 0;
+        uint64_t pushed = 0;
+        uint64_t popped = 0;
+        double totalLatencyUs = 0.0;
+        double maxLatencyUs = 0.0;
+    };
+
+    // Pick a lane according to the policy; caller holds the lock and totalSize_ > 0
+    size_t selectLaneLocked() {
+        if (policy_ == LanePolicy::Weighted) {
+            for (size_t i = 0; i < lanes_.size(); ++i) {
+                if (!lanes_[i].items.empty() && lanes_[i].credits > 0) {
+                    lanes_[i].credits--;
+                    return i;
+                }
+            }
+
+            // Every backlogged lane used its share, start a new round
+            for (auto& lane : lanes_) {
+                lane.credits = lane.config.weight;
+            }
+        }
+
+        for (size_t i = 0; i < lanes_.size(); ++i) {
+            if (!lanes_[i].items.empty()) {
+                if (policy_ == LanePolicy::Weighted) {
+                    lanes_[i].credits--;
+                }
+                return i;
+            }
+        }
+        return 0; // Unreachable while totalSize_ > 0
+    }
+
+    T popLocked() {
+        Lane& lane = lanes_[selectLaneLocked()];
+
+        Entry entry = std::move(lane.items.front());
+        lane.items.pop_front();
+        totalSize_--;
+
+        double latencyUs = std::chrono::duration<double, std::micro>(Clock::now() - entry.enqueued).count();
+        lane.popped++;
+        lane.totalLatencyUs += latencyUs;
+        lane.maxLatencyUs = std::max(lane.maxLatencyUs, latencyUs);
+
+        return std::move(entry.value);
+    }
+
+    mutable std::mutex mutex_;              // Protects all lanes
+    std::condition_variable condVar_;       // For blocking wait
+    std::vector<Lane> lanes_;               // Lanes in priority order
+    LanePolicy policy_;
+    size_t totalSize_ = 0;                  // Items across all lanes
+};
+
+#endif // PRIORITY_LANE_QUEUE_HPP
@@ -0,0 +1,90 @@
+#ifndef TELEMETRY_AGGREGATOR_HPP
+#define TELEMETRY_AGGREGATOR_HPP
+
+#include <json/json.h>
+#include <string>
+#include <vector>
+#include <functional>
+#include <unordered_map>
+#include <mutex>
+#include <cstdint>
+#include "ConfigManager.hpp"
+
+// Running summary of one numeric field
+struct FieldSummary {
+    uint64_t count = 0;
+    double min = 0.0;
+    double max = 0.0;
+    double sum = 0.0;
+    double last = 0.0;
+
+    void add(double value);
+    void merge(const FieldSummary& newer);   // newer supplies "last"
+};
+
+// Incrementally summarizes numeric telemetry per device and field over
+// tumbling and sliding windows, and publishes one batched message per
+// window when it closes.
+//
+// Each window is split into hop-sized buckets on the monotonic clock, so
+// NTP stepping the wall clock (the Pi has no RTC) neither stalls nor
+// bursts the windows. Samples update only the current bucket; when a hop
+// boundary passes, the last length/hop buckets are merged into the
+// published summary, stamped with the wall-clock time they correspond to.
+// Thread-safe: samples arrive on the MQTT callback thread while the
+// processor thread flushes idle windows. The publisher runs with the lock
+// held, so it must not block.
+class TelemetryAggregator {
+public:
+    using Publisher = std::function<bool(const std::string& topic, const Json::Value& message)>;
+
+    TelemetryAggregator(const AggregationConfig& config, Publisher publisher);
+
+    // Add the configured numeric fields of one message
+    // Closes any windows whose hop ended before nowMs (a nowMs() reading) first
+    void addSample(const std::string& deviceId, const Json::Value& message, int64_t nowMs);
+    void addSample(const std::string& deviceId, const Json::Value& message);
+
+    // Publish every window whose hop has ended; returns messages published
+    size_t flushDue(int64_t nowMs);
+    size_t flushDue();
+
+    // Counters
+    uint64_t samplesAdded() const;
+    uint64_t messagesPublished() const;
+
+    // Current monotonic time in milliseconds; drives the buckets
+    static int64_t nowMs();
+
+    // Current wall-clock time in milliseconds since the epoch; only for stamps
+    static int64_t wallClockMs();
+
+private:
+    // Ring of bucket summaries for one device field, indexed by bucket % size
+    using BucketRing = std::vector<FieldSummary>;
+    using DeviceFields = std::unordered_map<std::string, BucketRing>;
+
+    struct WindowState {
+        WindowSpec spec;
+        size_t bucketCount = 1;                                 // length / hop
+        int64_t currentBucket = -1;                             // Bucket index being filled
+        std::unordered_map<std::string, DeviceFields> devices;  // Device -> field -> buckets
+    };
+
+    // Close and publish every ended hop (caller holds the lock)
+    size_t flushDueLocked(int64_t nowMs);
+
+    // Publish the window ending at the current bucket and move to nextBucket
+    // wallOffsetMs converts bucket times to wall-clock stamps
+    bool closeWindow(WindowState& window, int64_t nextBucket, int64_t wallOffsetMs);
+
+    AggregationConfig config_;
+    Publisher publisher_;
+
+    mutable std::mutex mutex_;              // Protects everything below
+    std::vector<WindowState> windows_;
+    uint64_t samplesAdded_ = 0;
+    uint64_t messagesPublished_ = 0;
+};
+
+#endif // TELEMETRY_AGGREGATOR_HPP
@@ -0,0 +1,67 @@
+#ifndef THREAD_MANAGER_HPP
+#define THREAD_MANAGER_HPP
+
+#include <thread>
+#include <mutex>
+#include <vector>
+#include <string>
+#include <functional>
+#include <utility>
+
+// Scheduling attributes applied to a managed thread when it starts
+struct ThreadOptions {
+    std::string name;               // Shown in top/htop/ps (truncated to 15 chars by the kernel)
+    int cpuCore = -1;               // CPU to pin the thread to, -1 = no pinning
+    int realtimePriority = 0;       // SCHED_FIFO priority 1..99, 0 = normal SCHED_OTHER
+};
+
+// Creates and owns application threads.
+// Each thread gets its name, CPU affinity and scheduling policy applied
+// before the user function runs, and all threads are joined in creation
+// order by joinAll() or the destructor.
+class ThreadManager {
+public:
+    ThreadManager() = default;
+    ~ThreadManager();
+
+    // Threads are owned, so the manager can't be copied
+    ThreadManager(const ThreadManager&) = delete;
+    ThreadManager& operator=(const ThreadManager&) = delete;
+
+    // Start a new thread running fn(args...) with the given options
+    // Arguments are copied like std::thread, use std::ref() to pass references
+    template<typename Fn, typename... Args>
+    void spawn(const ThreadOptions& options, Fn&& fn, Args&&... args) {
+        std::thread thread(
+            [options, fn = std::forward<Fn>(fn)](auto&&... threadArgs) mutable {
+                applyToCurrentThread(options);
+                std::invoke(fn, std::forward<decltype(threadArgs)>(threadArgs)...);
+            },
+            std::forward<Args>(args)...
+        );
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        threads_.push_back({options.name, std::move(thread)});
+    }
+
+    // Join all managed threads in the order they were created
+    void joinAll();
+
+    // Number of threads that have not been joined yet
+    size_t count() const;
+
+    // Apply name, affinity and priority to the calling thread
+    // Returns false if any attribute could not be applied (e.g. missing CAP_SYS_NICE)
+    static bool applyToCurrentThread(const ThreadOptions& options);
+
+private:
+    struct ManagedThread {
+        std::string name;
+        std::thread thread;
+    };
+
+    mutable std::mutex mutex_;              // Protects threads_
+    std::vector<ManagedThread> threads_;    // Owned threads in creation order
+};
+
+#endif // THREAD_MANAGER_HPP
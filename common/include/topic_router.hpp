@@ -0,0 +1,78 @@
+#ifndef TOPIC_ROUTER_HPP
+#define TOPIC_ROUTER_HPP
+
+#include <json/json.h>
+#include <string>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <functional>
+#include <unordered_map>
+#include <cstdint>
+
+// Dispatches MQTT messages to handlers registered per topic filter.
+// Filters support the MQTT wildcards '+' (one level) and '#' (all remaining
+// levels). Filters are stored in a trie keyed by topic level, so a topic is
+// matched once in O(levels); the resulting handler list is cached per topic
+// so hot topics skip the trie entirely.
+class TopicRouter {
+public:
+    using Handler = std::function<void(const std::string& topic, const Json::Value& message)>;
+
+    explicit TopicRouter(size_t cacheCapacity = 4096);
+
+    // Routers own handlers and a cache, so they can't be copied
+    TopicRouter(const TopicRouter&) = delete;
+    TopicRouter& operator=(const TopicRouter&) = delete;
+
+    // Register a handler for a topic filter (e.g. "esp-lection/+/status")
+    // Returns false if the filter is not a valid MQTT topic filter
+    bool addRoute(const std::string& filter, Handler handler);
+
+    // Handler called for topics that match no route
+    void setDefaultHandler(Handler handler);
+
+    // Call every handler whose filter matches the topic, in registration order
+    // Returns the number of handlers called (0 if only the default handler ran)
+    size_t dispatch(const std::string& topic, const Json::Value& message);
+
+    // Number of handlers that would be called for the topic
+    size_t matchCount(const std::string& topic);
+
+    // Cache counters
+    uint64_t cacheHits() const;
+    uint64_t cacheMisses() const;
+
+private:
+    using HandlerPtr = std::shared_ptr<const Handler>;
+    using HandlerList = std::shared_ptr<const std::vector<HandlerPtr>>;
+
+    struct Node {
+        std::unordered_map<std::string, std::unique_ptr<Node>> children;
+        std::vector<size_t> routes;     // Indices into handlers_ of filters ending here
+    };
+
+    // Split a topic into its levels ("a/b/c" -> {"a", "b", "c"})
+    static std::vector<std::string> splitLevels(const std::string& topic);
+
+    // Check '+' and '#' are used as whole levels and '#' is last
+    static bool isValidFilter(const std::vector<std::string>& levels);
+
+    // Collect route indices matching levels[index..] below node
+    void matchNode(const Node& node, const std::vector<std::string>& levels,
+                   size_t index, std::vector<size_t>& matches) const;
+
+    // Find the handler list for a topic, using the cache (caller holds the lock)
+    HandlerList lookupLocked(const std::string& topic);
+
+    mutable std::mutex mutex_;                              // Protects everything below
+    Node root_;                                             // Trie of topic filters
+    std::vector<HandlerPtr> handlers_;                      // Handlers in registration order
+    HandlerPtr defaultHandler_;
+    std::unordered_map<std::string, HandlerList> cache_;    // Topic -> matching handlers
+    size_t cacheCapacity_;
+    uint64_t cacheHits_ = 0;
+    uint64_t cacheMisses_ = 0;
+};
+
+#endif // TOPIC_ROUTER_HPP
@@ -0,0 +1,132 @@
+#include "change_detector.hpp"
+#include <cmath>
+#include <functional>
+
+namespace {
+
+// Command replies must never be deduplicated: two identical "ok"s acknowledge two commands
+bool isReplyPayload(const std::string& payload) {
+    return payload.find("\"ok\"") != std::string::npos ||
+           payload.find("\"error\"") != std::string::npos;
+}
+
+bool isPlainNumber(const Json::Value& value) {
+    return value.isNumeric() && !value.isBool();
+}
+
+} // namespace
+
+ChangeDetector::ChangeDetector(const ChangeDetectionConfig& config)
+    : config_(config), ignoredFields_(config.ignoredFields.begin(), config.ignoredFields.end()) {
+}
+
+std::string ChangeDetector::rawDeviceId(const std::string& payload) {
+    static const std::string field = "\"device_id\"";
+    size_t pos = payload.find(field);
+    if (pos == std::string::npos) {
+        return "";
+    }
+
+    pos = payload.find_first_not_of(" \t\r\n", pos + field.size());
+    if (pos == std::string::npos || payload[pos] != ':') {
+        return "";
+    }
+    pos = payload.find_first_not_of(" \t\r\n", pos + 1);
+    if (pos == std::string::npos || payload[pos] != '"') {
+        return "";
+    }
+
+    size_t end = payload.find_first_of("\"\\", pos + 1);
+    if (end == std::string::npos || payload[end] != '"') {
+        return "";
+    }
+    return payload.substr(pos + 1, end - pos - 1);
+}
+
+std::string ChangeDetector::payloadKey(const std::string& topic, const std::string& deviceId) {
+    return deviceId.empty() ? topic : topic + '|' + deviceId;
+}
+
+ChangeVerdict ChangeDetector::checkPayload(const std::string& key, const std::string& payload) {
+    size_t hash = std::hash<std::string>{}(payload);
+    Clock::time_point now = Clock::now();
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    stats_.received++;
+
+    auto [it, inserted] = payloads_.try_emplace(key);
+    PayloadState& state = it->second;
+
+    if (inserted || state.hash != hash || isReplyPayload(payload)) {
+        state.hash = hash;
+        state.lastForwarded = now;
+        return ChangeVerdict::Changed;
+    }
+
+    ChangeVerdict verdict = unchangedVerdictLocked(state.lastForwarded, now);
+    if (verdict == ChangeVerdict::Suppressed) {
+        stats_.suppressedRaw++;
+    }
+    return verdict;
+}
+
+ChangeVerdict ChangeDetector::checkFields(const std::string& topic, const Json::Value& message) {
+    const Json::Value& deviceId = message["device_id"];
+    // Same key as stage 1, so devices sharing a topic stay apart
+    const std::string key = payloadKey(topic, deviceId.isString() ? deviceId.asString() : "");
+    Clock::time_point now = Clock::now();
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    DeviceState& device = devices_[key];
+
+    bool changed = message.isMember("ok") || message.isMember("error");
+    for (const auto& field : message.getMemberNames()) {
+        if (ignoredFields_.count(field)) {
+            continue;
+        }
+
+        const Json::Value& value = message[field];
+        auto previous = device.fields.find(field);
+        if (previous == device.fields.end() || fieldChanged(field, previous->second, value)) {
+            // Only changed fields move their reference, so slow drift still crosses the deadband
+            device.fields[field] = value;
+            changed = true;
+        }
+    }
+
+    if (changed) {
+        device.lastForwarded = now;
+        stats_.forwarded++;
+        return ChangeVerdict::Changed;
+    }
+
+    ChangeVerdict verdict = unchangedVerdictLocked(device.lastForwarded, now);
+    if (verdict == ChangeVerdict::Suppressed) {
+        stats_.suppressedFields++;
+    }
+    return verdict;
+}
+
+ChangeStats ChangeDetector::getStats() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return stats_;
+}
+
+ChangeVerdict ChangeDetector::unchangedVerdictLocked(Clock::time_point& lastForwarded, Clock::time_point now) {
+    if (config_.heartbeatIntervalMs > 0 &&
+        now - lastForwarded >= std::chrono::milliseconds(config_.heartbeatIntervalMs)) {
+        lastForwarded = now;
+        stats_.heartbeats++;
+        return ChangeVerdict::Heartbeat;
+    }
+    return ChangeVerdict::Suppressed;
+}
+
+bool ChangeDetector::fieldChanged(const std::string& field, const Json::Value& previous,
+                                  const Json::Value& value) const {
+    auto deadband = config_.deadbands.find(field);
+    if (deadband != config_.deadbands.end() && isPlainNumber(previous) && isPlainNumber(value)) {
+        return std::fabs(value.asDouble() - previous.asDouble()) > deadband->second;
+    }
+    return previous != value;
+}
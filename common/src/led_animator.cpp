@@ -0,0 +1,309 @@
+#include "led_animator.hpp"
+#include "logger.hpp"
+#include <algorithm>
+#include <cmath>
+#include <thread>
+
+extern Logger logger;
+
+// Animation implementation
+Animation::Animation(std::vector<Keyframe> keyframes, Easing easing, bool loop)
+    : keyframes_(std::move(keyframes)), easing_(easing), loop_(loop) {
+    if (keyframes_.empty()) {
+        keyframes_.push_back({0, LedFrame{}});
+    }
+    std::stable_sort(keyframes_.begin(), keyframes_.end(),
+                     [](const Keyframe& a, const Keyframe& b) { return a.atMs < b.atMs; });
+}
+
+Animation Animation::fade(const LedFrame& from, const LedFrame& to, int64_t durationMs, Easing easing) {
+    return Animation({{0, from}, {std::max<int64_t>(1, durationMs), to}}, easing, false);
+}
+
+Animation Animation::sequence(const std::vector<LedFrame>& frames, int64_t stepMs, bool loop) {
+    std::vector<Keyframe> keyframes;
+    int64_t at = 0;
+    for (const auto& frame : frames) {
+        keyframes.push_back({at, frame});
+        at += stepMs;
+    }
+
+    // Closing keyframe so the last frame is held for a full step too
+    if (!frames.empty()) {
+        keyframes.push_back({at, loop ? frames.front() : frames.back()});
+    }
+    return Animation(std::move(keyframes), Easing::Step, loop);
+}
+
+int64_t Animation::durationMs() const {
+    return keyframes_.back().atMs;
+}
+
+bool Animation::finished(int64_t elapsedMs) const {
+    return !loop_ && elapsedMs >= durationMs();
+}
+
+LedFrame Animation::sample(int64_t elapsedMs) const {
+    int64_t duration = durationMs();
+    if (loop_ && duration > 0) {
+        elapsedMs %= duration;
+    }
+
+    if (elapsedMs <= keyframes_.front().atMs) {
+        return keyframes_.front().frame;
+    }
+    if (elapsedMs >= duration) {
+        return keyframes_.back().frame;
+    }
+
+    // First keyframe strictly after elapsedMs; its predecessor starts the segment
+    auto next = std::upper_bound(keyframes_.begin(), keyframes_.end(), elapsedMs,
+                                 [](int64_t t, const Keyframe& k) { return t < k.atMs; });
+    auto prev = std::prev(next);
+
+    if (easing_ == Easing::Step) {
+        return prev->frame;
+    }
+
+    double t = static_cast<double>(elapsedMs - prev->atMs) / (next->atMs - prev->atMs);
+    if (easing_ == Easing::EaseInOut) {
+        t = t * t * (3.0 - 2.0 * t);
+    }
+
+    auto lerp = [t](int a, int b) {
+        return static_cast<int>(std::lround(a + (b - a) * t));
+    };
+
+    LedFrame frame;
+    frame.r = lerp(prev->frame.r, next->frame.r);
+    frame.g = lerp(prev->frame.g, next->frame.g);
+    frame.b = lerp(prev->frame.b, next->frame.b);
+
+    // Only interpolate the servo when both ends drive it
+    if (prev->frame.servoAngle >= 0 && next->frame.servoAngle >= 0) {
+        frame.servoAngle = lerp(prev->frame.servoAngle, next->frame.servoAngle);
+    } else {
+        frame.servoAngle = prev->frame.servoAngle;
+    }
+    return frame;
+}
+
+// LedAnimator implementation
+LedAnimator::LedAnimator(const AnimatorConfig& config, Sender sender)
+    : config_(config), sender_(std::move(sender)) {
+    config_.frameRateHz = std::max(1, config_.frameRateHz);
+}
+
+LedAnimator::~LedAnimator() {
+    stop();
+}
+
+void LedAnimator::start() {
+    if (running_.exchange(true)) {
+        return;
+    }
+    threads_.spawn(config_.renderThread, &LedAnimator::renderLoop, this);
+    threads_.spawn(config_.sendThread, &LedAnimator::sendLoop, this);
+    logger.log("Animator: Started at " + std::to_string(config_.frameRateHz) + " fps");
+}
+
+void LedAnimator::stop() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!running_.exchange(false)) {
+            return;
+        }
+    } // Cleared under the lock so the send thread can't miss the wakeup
+
+    renderCv_.notify_all();
+    sendCv_.notify_all();
+    threads_.joinAll();
+}
+
+void LedAnimator::play(const std::string& deviceId, Animation animation) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        devices_[deviceId].playback = Playback{std::move(animation), Clock::now()};
+    }
+    renderCv_.notify_one();
+}
+
+void LedAnimator::cancel(const std::string& deviceId) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = devices_.find(deviceId);
+    if (it != devices_.end()) {
+        it->second.playback.reset();
+    }
+}
+
+LedFrame LedAnimator::currentFrame(const std::string& deviceId) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = devices_.find(deviceId);
+    return it != devices_.end() ? it->second.lastRendered : LedFrame{};
+}
+
+size_t LedAnimator::activeCount() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return std::count_if(devices_.begin(), devices_.end(),
+                         [](const auto& entry) { return entry.second.playback.has_value(); });
+}
+
+bool LedAnimator::anyPlayingLocked() const {
+    return std::any_of(devices_.begin(), devices_.end(),
+                       [](const auto& entry) { return entry.second.playback.has_value(); });
+}
+
+AnimatorStats LedAnimator::getStats() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return stats_;
+}
+
+void LedAnimator::renderLoop() {
+    const auto period = std::chrono::duration_cast<Clock::duration>(
+        std::chrono::duration<double>(1.0 / config_.frameRateHz));
+
+    Clock::time_point previous = Clock::now();
+    Clock::time_point next = previous + period;
+
+    while (running_.load()) {
+        // Absolute deadlines so sleep error doesn't accumulate into drift
+        std::this_thread::sleep_until(next);
+        Clock::time_point now = Clock::now();
+
+        double intervalUs = std::chrono::duration<double, std::micro>(now - previous).count();
+        double periodUs = std::chrono::duration<double, std::micro>(period).count();
+        double jitterUs = std::abs(intervalUs - periodUs);
+        previous = now;
+
+        bool haveFrames;
+        bool playing;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stats_.ticks++;
+            stats_.avgJitterUs += (jitterUs - stats_.avgJitterUs) / stats_.ticks;
+            stats_.maxJitterUs = std::max(stats_.maxJitterUs, jitterUs);
+
+            // A full period behind: skip the missed ticks instead of bursting
+            if (now - next >= period) {
+                stats_.overruns++;
+                next = now;
+            }
+
+            renderTickLocked(now);
+            haveFrames = !ready_.empty();
+            playing = anyPlayingLocked();
+        }
+
+        if (haveFrames) {
+            sendCv_.notify_one();
+        }
+        next += period;
+
+        // Nothing to animate: park until play() or stop() instead of ticking idle
+        if (!playing) {
+            std::unique_lock<std::mutex> lock(mutex_);
+            renderCv_.wait(lock, [this] { return !running_.load() || anyPlayingLocked(); });
+
+            // Restart the schedule so the idle time isn't counted as jitter or overruns
+            previous = Clock::now();
+            next = previous + period;
+        }
+    }
+}
+
+void LedAnimator::renderTickLocked(Clock::time_point now) {
+    for (auto& [deviceId, device] : devices_) {
+        if (!device.playback) {
+            continue;
+        }
+
+        int64_t elapsedMs = std::chrono::duration_cast<std::chrono::milliseconds>(
+            now - device.playback->startedAt).count();
+        LedFrame frame = device.playback->animation.sample(elapsedMs);
+
+        if (device.playback->animation.finished(elapsedMs)) {
+            device.playback.reset();
+        }
+
+        // Holding a color produces no traffic
+        if (device.rendered && frame == device.lastRendered) {
+            continue;
+        }
+        device.lastRendered = frame;
+        device.rendered = true;
+        stats_.framesRendered++;
+
+        bool wasEmpty = !device.slot.hasValue();
+        if (device.slot.store(frame)) {
+            stats_.framesDropped++;
+        }
+        if (wasEmpty) {
+            ready_.push_back(deviceId);
+        }
+    }
+}
+
+void LedAnimator::sendLoop() {
+    std::unique_lock<std::mutex> lock(mutex_);
+
+    while (true) {
+        sendCv_.wait(lock, [this] { return !running_.load() || !ready_.empty(); });
+        if (!running_.load()) {
+            break;
+        }
+
+        std::string deviceId = std::move(ready_.front());
+        ready_.pop_front();
+
+        auto it = devices_.find(deviceId);
+        if (it == devices_.end()) {
+            continue;
+        }
+
+        std::optional<LedFrame> frame = it->second.slot.take();
+        if (!frame) {
+            continue;
+        }
+        std::vector<Json::Value> commands = commandsFor(*frame, it->second.lastSent);
+        it->second.lastSent = *frame;
+
+        // Publish without the lock so rendering continues meanwhile;
+        // frames rendered during a slow send coalesce in the slot
+        lock.unlock();
+        bool sent = true;
+        for (const auto& command : commands) {
+            sent = sender_(deviceId, command) && sent;
+        }
+        lock.lock();
+
+        if (sent) {
+            stats_.framesSent++;
+        }
+    }
+}
+
+std::vector<Json::Value> LedAnimator::commandsFor(const LedFrame& frame, const std::optional<LedFrame>& lastSent) {
+    std::vector<Json::Value> commands;
+
+    bool colorChanged = !lastSent || lastSent->r != frame.r ||
+                        lastSent->g != frame.g || lastSent->b != frame.b;
+    if (colorChanged) {
+        Json::Value command;
+        command["cmd"] = "led_color";
+        command["r"] = frame.r;
+        command["g"] = frame.g;
+        command["b"] = frame.b;
+        commands.push_back(command);
+    }
+
+    bool servoChanged = frame.servoAngle >= 0 &&
+                        (!lastSent || lastSent->servoAngle != frame.servoAngle);
+    if (servoChanged) {
+        Json::Value command;
+        command["cmd"] = "servo_angle";
+        command["angle"] = frame.servoAngle;
+        commands.push_back(command);
+    }
+
+    return commands;
+}
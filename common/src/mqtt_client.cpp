@@ -1,21 +1,93 @@
 #include "mqtt_client.hpp"
 #include "logger.hpp"
 #include <iostream>
+#include <random>
+#include <algorithm>
 
 extern Logger logger;
 
+MessageLane selectMessageLane(const std::string& topic, const Json::Value& message) {
+    // Replies to our commands carry an "ok" or "error" field
+    if (message.isMember("ok") || message.isMember("error")) {
+        return MessageLane::Control;
+    }
+
+    // Devices that publish replies on a dedicated topic
+    auto endsWith = [&topic](const std::string& suffix) {
+        return topic.size() >= suffix.size() &&
+               topic.compare(topic.size() - suffix.size(), suffix.size(), suffix) == 0;
+    };
+    if (endsWith("/ack") || endsWith("/reply")) {
+        return MessageLane::Control;
+    }
+
+    return MessageLane::Telemetry;
+}
+
 // MQTTCallback implementation
-MQTTCallback::MQTTCallback(ThreadSafeQueue<Json::Value>* messageQueue)
-    : messageQueue_(messageQueue) {
+MQTTCallback::MQTTCallback(MessageQueue* messageQueue, MQTTClient* owner)
+    : messageQueue_(messageQueue), owner_(owner) {
+}
+
+void MQTTCallback::connected(const std::string& cause) {
+    if (owner_) {
+        owner_->handleConnected(cause);
+    }
+}
+
+void MQTTCallback::setChangeDetector(ChangeDetector* changeDetector) {
+    changeDetector_ = changeDetector;
+}
+
+void MQTTCallback::ignoreTopic(const std::string& filter) {
+    ignoredTopics_.addRoute(filter, [](const std::string&, const Json::Value&) {});
+}
+
+void MQTTCallback::setSampleSink(SampleSink sink) {
+    sampleSink_ = std::move(sink);
+}
+
+void MQTTCallback::pushHeartbeat(const std::string& topic, const Json::Value& deviceId) {
+    if (!messageQueue_) {
+        return;
+    }
+    Json::Value heartbeat;
+    heartbeat["heartbeat"] = true;
+    if (deviceId.isString()) {
+        heartbeat["device_id"] = deviceId;
+    }
+    messageQueue_->push({topic, std::move(heartbeat)}, static_cast<size_t>(MessageLane::Telemetry));
 }
 
 void MQTTCallback::message_arrived(mqtt::const_message_ptr msg) {
     try {
-        logger.log("MQTT: Message arrived on topic: " + msg->get_topic());
+        const std::string& topic = msg->get_topic();
+        
+        if (ignoredTopics_.matchCount(topic) > 0) {
+            return;
+        }
         
         // Get the payload as string
         std::string payload = msg->to_string();
-        logger.log("MQTT: Payload: " + payload);
+        
+        // Drop byte-identical repeats before logging or parsing them
+        std::string sampleKey;
+        if (changeDetector_) {
+            std::string deviceId = ChangeDetector::rawDeviceId(payload);
+            sampleKey = ChangeDetector::payloadKey(topic, deviceId);
+            ChangeVerdict verdict = changeDetector_->checkPayload(sampleKey, payload);
+            if (verdict != ChangeVerdict::Changed) {
+                // Same bytes as last time, so the same values still count as a sample
+                auto last = lastSamples_.find(sampleKey);
+                if (sampleSink_ && last != lastSamples_.end()) {
+                    sampleSink_(topic, last->second);
+                }
+                if (verdict == ChangeVerdict::Heartbeat) {
+                    pushHeartbeat(topic, deviceId.empty() ? Json::Value() : Json::Value(deviceId));
+                }
+                return;
+            }
+        }
         
         // Parse JSON
         Json::CharReaderBuilder builder;
@@ -33,7 +105,7 @@ void MQTTCallback::message_arrived(mqtt::const_message_ptr msg) {
         delete reader;
         
         if (!parsingSuccessful) {
-            logger.log("MQTT: Failed to parse JSON: " + errors);
+            logger.log("MQTT: Failed to parse JSON on topic " + topic + ": " + errors);
             return;
         }
         
@@ -43,10 +115,35 @@ void MQTTCallback::message_arrived(mqtt::const_message_ptr msg) {
             return;
         }
         
+        // Samples are taken before the deadband check, which would thin them out
+        if (sampleSink_) {
+            sampleSink_(topic, jsonMessage);
+            if (changeDetector_) {
+                lastSamples_[sampleKey] = jsonMessage;
+            }
+        }
+        
+        // Per-field comparison with deadbands
+        if (changeDetector_) {
+            ChangeVerdict verdict = changeDetector_->checkFields(topic, jsonMessage);
+            if (verdict == ChangeVerdict::Heartbeat) {
+                pushHeartbeat(topic, jsonMessage["device_id"]);
+            }
+            if (verdict != ChangeVerdict::Changed) {
+                return;
+            }
+        }
+        
+        // Only forwarded messages are logged, so suppression also saves the logging
+        logger.log("MQTT: Message arrived on topic: " + topic);
+        logger.log("MQTT: Payload: " + payload);
+        
         // Push to message queue
         if (messageQueue_) {
-            messageQueue_->push(jsonMessage);
-            logger.log("MQTT: Message pushed to queue");
+            MessageLane lane = selectMessageLane(topic, jsonMessage);
+            messageQueue_->push({topic, std::move(jsonMessage)}, static_cast<size_t>(lane));
+            logger.log(std::string("MQTT: Message pushed to ") +
+                       (lane == MessageLane::Control ? "control" : "telemetry") + " lane");
         }
         
     } catch (const std::exception& e) {
@@ -59,7 +156,22 @@ void MQTTCallback::connection_lost(const std::string& cause) {
     if (!cause.empty()) {
         logger.log("MQTT: Cause: " + cause);
     }
-    logger.log("MQTT: Automatic reconnection will be attempted...");
+    if (owner_) {
+        owner_->handleConnectionLost();
+    }
+}
+
+// SubscribeListener implementation
+SubscribeListener::SubscribeListener(MQTTClient* owner) : owner_(owner) {
+}
+
+void SubscribeListener::on_success(const mqtt::token& tok) {
+    bool granted = MQTTClient::subscriptionsGranted(tok);
+    owner_->handleSubscribeResult(granted, granted ? "" : "rejected by broker");
+}
+
+void SubscribeListener::on_failure(const mqtt::token& tok) {
+    owner_->handleSubscribeResult(false, "return code " + std::to_string(tok.get_return_code()));
 }
 
 void MQTTCallback::delivery_complete(mqtt::delivery_token_ptr tok) {
@@ -67,20 +179,37 @@ void MQTTCallback::delivery_complete(mqtt::delivery_token_ptr tok) {
 }
 
 // MQTTClient implementation
-MQTTClient::MQTTClient(const MQTTConfig& config, ThreadSafeQueue<Json::Value>* messageQueue)
+MQTTClient::MQTTClient(const MQTTConfig& config, MessageQueue* messageQueue)
     : config_(config), messageQueue_(messageQueue) {
     
-    // Create the async client
-    client_ = std::make_unique<mqtt::async_client>(config_.brokerAddress, config_.clientId);
+    // Create the async client; a persistence directory keeps in-flight
+    // QoS-1 messages on disk so they survive a reconnect or restart
+    if (config_.persistenceDir.empty()) {
+        client_ = std::make_unique<mqtt::async_client>(config_.brokerAddress, config_.clientId);
+    } else {
+        client_ = std::make_unique<mqtt::async_client>(config_.brokerAddress, config_.clientId,
+                                                       config_.persistenceDir);
+    }
     
     // Create callback
-    callback_ = std::make_unique<MQTTCallback>(messageQueue_);
+    callback_ = std::make_unique<MQTTCallback>(messageQueue_, this);
+    subscribeListener_ = std::make_unique<SubscribeListener>(this);
     
     // Set callback
     client_->set_callback(*callback_);
+    
+    // Configure connection options
+    // Reconnects are driven by reconnectLoop() so backoff can be jittered
+    connOpts_.set_keep_alive_interval(config_.keepAliveInterval);
+    connOpts_.set_clean_session(config_.cleanSession);
+    connOpts_.set_automatic_reconnect(false);
+    
+    // Paho fails a connect attempt after this, so a timed-out wait always ends
+    connOpts_.set_connect_timeout(std::chrono::milliseconds(config_.timeout));
 }
 
 MQTTClient::~MQTTClient() {
+    stopReconnectThread();
     if (client_ && client_->is_connected()) {
         try {
             disconnect();
@@ -94,19 +223,39 @@ bool MQTTClient::connect() {
     try {
         logger.log("MQTT: Connecting to broker: " + config_.brokerAddress);
         logger.log("MQTT: Client ID: " + config_.clientId);
+        logger.log(std::string("MQTT: Session: ") + (config_.cleanSession ? "clean" : "persistent"));
         
-        // Configure connection options
-        mqtt::connect_options connOpts;
-        connOpts.set_keep_alive_interval(config_.keepAliveInterval);
-        connOpts.set_clean_session(true);
-        connOpts.set_automatic_reconnect(true);
+        {
+            std::lock_guard<std::mutex> lock(stateMutex_);
+            stopping_ = false;
+            subscribeState_ = SubscribeState::Idle;
+            if (threads_.count() == 0) {
+                threads_.spawn({.name = "mqtt-reconnect"}, &MQTTClient::reconnectLoop, this);
+            }
+        }
         
-        // Connect to the broker
-        mqtt::token_ptr conntok = client_->connect(connOpts);
-        conntok->wait_for(config_.timeout);
+        // Connect to the broker; subscriptions are sent from the connected callback
+        mqtt::token_ptr conntok = client_->connect(connOpts_);
+        if (!conntok->wait_for(config_.timeout)) {
+            logger.log("MQTT: Connection timed out");
+            return false;
+        }
         
         logger.log("MQTT: Connected successfully!");
-        return true;
+        
+        // The batched SUBSCRIBE goes out from the connected callback; wait for its SUBACK
+        std::unique_lock<std::mutex> lock(stateMutex_);
+        if (subscriptions_.empty()) {
+            return true;
+        }
+        bool answered = subscribeCv_.wait_for(lock, std::chrono::milliseconds(config_.timeout), [this] {
+            return subscribeState_ == SubscribeState::Granted || subscribeState_ == SubscribeState::Failed;
+        });
+        if (!answered) {
+            logger.log("MQTT: Subscription timed out");
+            return false;
+        }
+        return subscribeState_ == SubscribeState::Granted;
         
     } catch (const mqtt::exception& exc) {
         logger.log("MQTT: Connection failed: " + std::string(exc.what()));
@@ -115,6 +264,7 @@ bool MQTTClient::connect() {
 }
 
 void MQTTClient::disconnect() {
+    stopReconnectThread();
     try {
         if (client_ && client_->is_connected()) {
             logger.log("MQTT: Disconnecting...");
@@ -126,19 +276,47 @@ void MQTTClient::disconnect() {
     }
 }
 
+void MQTTClient::setChangeDetector(ChangeDetector* changeDetector) {
+    callback_->setChangeDetector(changeDetector);
+}
+
+void MQTTClient::ignoreInbound(const std::string& filter) {
+    callback_->ignoreTopic(filter);
+}
+
+void MQTTClient::setSampleSink(SampleSink sink) {
+    callback_->setSampleSink(std::move(sink));
+}
+
 bool MQTTClient::isConnected() const {
     return client_ && client_->is_connected();
 }
 
 bool MQTTClient::subscribe(const std::string& topic, int qos) {
+    {
+        std::lock_guard<std::mutex> lock(stateMutex_);
+        auto existing = std::find_if(subscriptions_.begin(), subscriptions_.end(),
+                                     [&topic](const Subscription& sub) { return sub.topic == topic; });
+        if (existing != subscriptions_.end()) {
+            existing->qos = qos;
+        } else {
+            subscriptions_.push_back({topic, qos});
+        }
+    }
+    
+    if (!isConnected()) {
+        logger.log("MQTT: Subscription to " + topic + " will be sent on connect");
+        return true;
+    }
+    
     try {
-        if (!isConnected()) {
-            logger.log("MQTT: Cannot subscribe - not connected");
+        logger.log("MQTT: Subscribing to topic: " + topic);
+        mqtt::token_ptr tok = client_->subscribe(topic, qos);
+        tok->wait();
+        if (!subscriptionsGranted(*tok)) {
+            logger.log("MQTT: Subscribe rejected by broker: " + topic);
             return false;
         }
-        
-        logger.log("MQTT: Subscribing to topic: " + topic);
-        client_->subscribe(topic, qos)->wait();
         logger.log("MQTT: Subscribed successfully");
         return true;
         
@@ -148,14 +326,163 @@ bool MQTTClient::subscribe(const std::string& topic, int qos) {
     }
 }
 
-bool MQTTClient::publishJSON(const std::string& topic, const Json::Value& message, int qos) {
+ReconnectStats MQTTClient::getReconnectStats() const {
+    std::lock_guard<std::mutex> lock(stateMutex_);
+    return reconnectStats_;
+}
+
+void MQTTClient::handleConnected(const std::string& cause) {
+    if (!cause.empty()) {
+        logger.log("MQTT: Connected (" + cause + ")");
+    }
+    
+    resubscribeAll();
+    
+    std::lock_guard<std::mutex> lock(stateMutex_);
+    if (connectionLost_) {
+        double recoveryMs = std::chrono::duration<double, std::milli>(Clock::now() - lostAt_).count();
+        
+        ReconnectStats& stats = reconnectStats_;
+        stats.recoveries++;
+        stats.lastRecoveryMs = recoveryMs;
+        stats.maxRecoveryMs = std::max(stats.maxRecoveryMs, recoveryMs);
+        stats.avgRecoveryMs += (recoveryMs - stats.avgRecoveryMs) / stats.recoveries;
+        
+        connectionLost_ = false;
+        logger.log("MQTT: Recovered after " + std::to_string(static_cast<long>(recoveryMs)) + " ms");
+    }
+    reconnectCv_.notify_all();
+}
+
+void MQTTClient::handleConnectionLost() {
+    std::lock_guard<std::mutex> lock(stateMutex_);
+    if (stopping_ || connectionLost_) {
+        return;
+    }
+    
+    connectionLost_ = true;
+    lostAt_ = Clock::now();
+    reconnectStats_.outages++;
+    logger.log("MQTT: Reconnection will be attempted...");
+    reconnectCv_.notify_all();
+}
+
+void MQTTClient::resubscribeAll() {
+    std::vector<std::string> topics;
+    mqtt::iasync_client::qos_collection qos;
+    {
+        std::lock_guard<std::mutex> lock(stateMutex_);
+        for (const auto& sub : subscriptions_) {
+            topics.push_back(sub.topic);
+            qos.push_back(sub.qos);
+        }
+    }
+    
+    if (topics.empty()) {
+        return;
+    }
+    
+    {
+        std::lock_guard<std::mutex> lock(stateMutex_);
+        subscribeState_ = SubscribeState::Pending;
+    }
+    
+    try {
+        // Runs on Paho's callback thread, so the result arrives via subscribeListener_
+        logger.log("MQTT: Subscribing to " + std::to_string(topics.size()) + " topic(s)");
+        client_->subscribe(mqtt::string_collection::create(topics), qos, nullptr, *subscribeListener_);
+    } catch (const mqtt::exception& exc) {
+        handleSubscribeResult(false, exc.what());
+    }
+}
+
+void MQTTClient::handleSubscribeResult(bool granted, const std::string& detail) {
+    if (granted) {
+        logger.log("MQTT: Subscribed successfully");
+    } else {
+        logger.log("MQTT: Subscribe failed: " + detail);
+    }
+    
+    std::lock_guard<std::mutex> lock(stateMutex_);
+    subscribeState_ = granted ? SubscribeState::Granted : SubscribeState::Failed;
+    if (!granted) {
+        reconnectStats_.resubscribeFailures++;
+    }
+    subscribeCv_.notify_all();
+}
+
+bool MQTTClient::subscriptionsGranted(const mqtt::token& tok) {
+    // SUBACK carries the granted QoS per topic, or 0x80 for a rejected filter
+    for (auto code : tok.get_subscribe_response().get_reason_codes()) {
+        if (static_cast<int>(code) >= 0x80) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void MQTTClient::reconnectLoop() {
+    std::mt19937 rng(std::random_device{}());
+    std::unique_lock<std::mutex> lock(stateMutex_);
+    
+    while (!stopping_) {
+        reconnectCv_.wait(lock, [this] { return stopping_ || connectionLost_; });
+        
+        int attempt = 0;
+        while (connectionLost_ && !stopping_) {
+            // Full jitter: uniform in [min, min * 2^attempt], capped at max
+            int minDelay = std::max(1, config_.reconnectMinDelayMs);
+            int maxDelay = std::max(minDelay, config_.reconnectMaxDelayMs);
+            long ceiling = static_cast<long>(minDelay) << std::min(attempt, 20);
+            std::uniform_int_distribution<long> jitter(minDelay, std::min<long>(ceiling, maxDelay));
+            long delayMs = jitter(rng);
+            
+            logger.log("MQTT: Reconnect attempt " + std::to_string(attempt + 1) +
+                       " in " + std::to_string(delayMs) + " ms");
+            
+            // Wake early on shutdown, or if the connection came back on its own
+            if (reconnectCv_.wait_for(lock, std::chrono::milliseconds(delayMs),
+                                      [this] { return stopping_ || !connectionLost_; })) {
+                break;
+            }
+            
+            reconnectStats_.attempts++;
+            lock.unlock();
+            try {
+                mqtt::token_ptr conntok = client_->connect(connOpts_);
+                if (!conntok->wait_for(config_.timeout)) {
+                    // Let the attempt finish (bounded by the connect timeout) before the
+                    // next one, otherwise connect() is called while this one is pending
+                    logger.log("MQTT: Reconnect attempt timed out, waiting for it to finish");
+                    conntok->wait();
+                }
+            } catch (const mqtt::exception& exc) {
+                logger.log("MQTT: Reconnect failed: " + std::string(exc.what()));
+            }
+            lock.lock();
+            
+            attempt++;
+        }
+    }
+}
+
+void MQTTClient::stopReconnectThread() {
+    {
+        std::lock_guard<std::mutex> lock(stateMutex_);
+        stopping_ = true;
+    }
+    reconnectCv_.notify_all();
+    threads_.joinAll();
+}
+
+bool MQTTClient::publishJSON(const std::string& topic, const Json::Value& message, int qos, bool verbose) {
     try {
         // Serialize JSON to string
         Json::StreamWriterBuilder builder;
         builder["indentation"] = ""; // Compact output
         std::string payload = Json::writeString(builder, message);
         
-        return publishString(topic, payload, qos);
+        return publishString(topic, payload, qos, verbose);
         
     } catch (const std::exception& e) {
         logger.log("MQTT: JSON serialization failed: " + std::string(e.what()));
@@ -163,21 +490,53 @@ bool MQTTClient::publishJSON(const std::string& topic, const Json::Value& messag
     }
 }
 
-bool MQTTClient::publishString(const std::string& topic, const std::string& payload, int qos) {
+bool MQTTClient::publishJSONAsync(const std::string& topic, const Json::Value& message, int qos) {
     try {
         if (!isConnected()) {
             logger.log("MQTT: Cannot publish - not connected");
             return false;
         }
         
-        logger.log("MQTT: Publishing to topic: " + topic);
-        logger.log("MQTT: Payload: " + payload);
+        Json::StreamWriterBuilder builder;
+        builder["indentation"] = ""; // Compact output
+        std::string payload = Json::writeString(builder, message);
+        
+        mqtt::message_ptr pubmsg = mqtt::make_message(topic, payload);
+        pubmsg->set_qos(qos);
+        
+        // Delivery is reported through delivery_complete; don't block on the token
+        client_->publish(pubmsg);
+        logger.log("MQTT: Published " + std::to_string(payload.size()) + " bytes to topic: " + topic);
+        return true;
+        
+    } catch (const std::exception& e) {
+        logger.log("MQTT: Publish failed: " + std::string(e.what()));
+        return false;
+    }
+}
+
+bool MQTTClient::publishString(const std::string& topic, const std::string& payload, int qos, bool verbose) {
+    try {
+        if (!isConnected()) {
+            // An outage is already reported by connection_lost; don't repeat it per frame
+            if (verbose) {
+                logger.log("MQTT: Cannot publish - not connected");
+            }
+            return false;
+        }
+        
+        if (verbose) {
+            logger.log("MQTT: Publishing to topic: " + topic);
+            logger.log("MQTT: Payload: " + payload);
+        }
         
         mqtt::message_ptr pubmsg = mqtt::make_message(topic, payload);
         pubmsg->set_qos(qos);
         
         client_->publish(pubmsg)->wait_for(config_.timeout);
-        logger.log("MQTT: Published successfully");
+        if (verbose) {
+            logger.log("MQTT: Published successfully");
+        }
         return true;
         
     } catch (const mqtt::exception& exc) {
@@ -0,0 +1,203 @@
+#include "telemetry_aggregator.hpp"
+#include <algorithm>
+#include <chrono>
+
+void FieldSummary::add(double value) {
+    if (count == 0) {
+        min = max = value;
+    } else {
+        min = std::min(min, value);
+        max = std::max(max, value);
+    }
+    count++;
+    sum += value;
+    last = value;
+}
+
+void FieldSummary::merge(const FieldSummary& newer) {
+    if (newer.count == 0) {
+        return;
+    }
+    if (count == 0) {
+        *this = newer;
+        return;
+    }
+    min = std::min(min, newer.min);
+    max = std::max(max, newer.max);
+    count += newer.count;
+    sum += newer.sum;
+    last = newer.last;
+}
+
+TelemetryAggregator::TelemetryAggregator(const AggregationConfig& config, Publisher publisher)
+    : config_(config), publisher_(std::move(publisher)) {
+    for (const auto& spec : config_.windows) {
+        WindowState window;
+        window.spec = spec;
+        window.spec.hopMs = std::max(1, spec.hopMs);
+        window.spec.lengthMs = std::max(window.spec.hopMs, spec.lengthMs);
+
+        // Length is rounded up to a whole number of hops
+        window.bucketCount = (window.spec.lengthMs + window.spec.hopMs - 1) / window.spec.hopMs;
+        windows_.push_back(std::move(window));
+    }
+}
+
+int64_t TelemetryAggregator::nowMs() {
+    using namespace std::chrono;
+    return duration_cast<milliseconds>(steady_clock::now().time_since_epoch()).count();
+}
+
+int64_t TelemetryAggregator::wallClockMs() {
+    using namespace std::chrono;
+    return duration_cast<milliseconds>(system_clock::now().time_since_epoch()).count();
+}
+
+void TelemetryAggregator::addSample(const std::string& deviceId, const Json::Value& message) {
+    addSample(deviceId, message, nowMs());
+}
+
+void TelemetryAggregator::addSample(const std::string& deviceId, const Json::Value& message, int64_t nowMs) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    flushDueLocked(nowMs);
+
+    bool matched = false;
+    for (const auto& field : config_.fields) {
+        const Json::Value& value = message[field];
+        if (value.isBool() || !value.isNumeric()) {
+            continue;
+        }
+        matched = true;
+
+        double sample = value.asDouble();
+        for (auto& window : windows_) {
+            BucketRing& ring = window.devices[deviceId][field];
+            if (ring.empty()) {
+                ring.resize(window.bucketCount);
+            }
+            ring[window.currentBucket % window.bucketCount].add(sample);
+        }
+    }
+
+    if (matched) {
+        samplesAdded_++;
+    }
+}
+
+size_t TelemetryAggregator::flushDue() {
+    return flushDue(nowMs());
+}
+
+size_t TelemetryAggregator::flushDue(int64_t nowMs) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return flushDueLocked(nowMs);
+}
+
+uint64_t TelemetryAggregator::samplesAdded() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return samplesAdded_;
+}
+
+uint64_t TelemetryAggregator::messagesPublished() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return messagesPublished_;
+}
+
+size_t TelemetryAggregator::flushDueLocked(int64_t nowMs) {
+    size_t published = 0;
+
+    // Maps monotonic bucket boundaries onto the wall clock for the stamps
+    const int64_t wallOffsetMs = wallClockMs() - TelemetryAggregator::nowMs();
+
+    for (auto& window : windows_) {
+        int64_t bucket = nowMs / window.spec.hopMs;
+
+        if (window.currentBucket < 0) {
+            window.currentBucket = bucket;
+            continue;
+        }
+
+        // Close every hop that ended, skipping straight ahead once no data is left
+        while (window.currentBucket < bucket) {
+            if (window.devices.empty()) {
+                window.currentBucket = bucket;
+                break;
+            }
+            if (closeWindow(window, window.currentBucket + 1, wallOffsetMs)) {
+                published++;
+            }
+        }
+    }
+
+    return published;
+}
+
+bool TelemetryAggregator::closeWindow(WindowState& window, int64_t nextBucket, int64_t wallOffsetMs) {
+    const int64_t endBucket = window.currentBucket;
+    const size_t bucketCount = window.bucketCount;
+
+    Json::Value devices(Json::objectValue);
+    for (const auto& [deviceId, fields] : window.devices) {
+        Json::Value deviceJson(Json::objectValue);
+
+        for (const auto& [field, ring] : fields) {
+            // Merge oldest to newest so "last" comes from the newest bucket
+            FieldSummary total;
+            for (size_t k = bucketCount; k-- > 0;) {
+                int64_t b = endBucket - static_cast<int64_t>(k);
+                if (b >= 0) {
+                    total.merge(ring[b % bucketCount]);
+                }
+            }
+            if (total.count == 0) {
+                continue;
+            }
+
+            Json::Value summary;
+            summary["n"] = Json::UInt64(total.count);
+            summary["min"] = total.min;
+            summary["max"] = total.max;
+            summary["mean"] = total.sum / total.count;
+            summary["last"] = total.last;
+            deviceJson[field] = summary;
+        }
+
+        if (!deviceJson.empty()) {
+            devices[deviceId] = deviceJson;
+        }
+    }
+
+    // Clear the buckets that fall out of the window and drop idle devices
+    for (auto deviceIt = window.devices.begin(); deviceIt != window.devices.end();) {
+        bool active = false;
+        for (auto& [field, ring] : deviceIt->second) {
+            if (nextBucket - endBucket >= static_cast<int64_t>(bucketCount)) {
+                std::fill(ring.begin(), ring.end(), FieldSummary{});
+            } else {
+                for (int64_t b = endBucket + 1; b <= nextBucket; ++b) {
+                    ring[b % bucketCount] = FieldSummary{};
+                }
+            }
+            active = active || std::any_of(ring.begin(), ring.end(),
+                                           [](const FieldSummary& s) { return s.count > 0; });
+        }
+        deviceIt = active ? std::next(deviceIt) : window.devices.erase(deviceIt);
+    }
+    window.currentBucket = nextBucket;
+
+    if (devices.empty() || !publisher_) {
+        return false;
+    }
+
+    Json::Value message;
+    message["window"] = window.spec.name;
+    message["start"] = Json::Int64((endBucket + 1 - static_cast<int64_t>(bucketCount)) * window.spec.hopMs + wallOffsetMs);
+    message["end"] = Json::Int64((endBucket + 1) * window.spec.hopMs + wallOffsetMs);
+    message["devices"] = devices;
+
+    if (!publisher_(config_.topic, message)) {
+        return false;
+    }
+    messagesPublished_++;
+    return true;
+}
@@ -0,0 +1,77 @@
+#include "thread_manager.hpp"
+#include "logger.hpp"
+#include <pthread.h>
+#include <sched.h>
+#include <cstring>
+
+extern Logger logger;
+
+ThreadManager::~ThreadManager() {
+    joinAll();
+}
+
+void ThreadManager::joinAll() {
+    std::vector<ManagedThread> threads;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        threads.swap(threads_);
+    } // Join without holding the lock so threads may still spawn helpers
+
+    for (auto& managed : threads) {
+        if (managed.thread.joinable()) {
+            managed.thread.join();
+            logger.log("Thread joined: " + managed.name);
+        }
+    }
+}
+
+size_t ThreadManager::count() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return threads_.size();
+}
+
+bool ThreadManager::applyToCurrentThread(const ThreadOptions& options) {
+    bool ok = true;
+    pthread_t self = pthread_self();
+
+    if (!options.name.empty()) {
+        // Linux limits thread names to 16 bytes including the terminator
+        std::string name = options.name.substr(0, 15);
+        int err = pthread_setname_np(self, name.c_str());
+        if (err != 0) {
+            logger.log("Thread: Failed to set name '" + name + "': " + std::strerror(err));
+            ok = false;
+        }
+    }
+
+    if (options.cpuCore >= CPU_SETSIZE) {
+        logger.log("Thread: CPU " + std::to_string(options.cpuCore) + " out of range for '" +
+                   options.name + "'");
+        ok = false;
+    } else if (options.cpuCore >= 0) {
+        cpu_set_t cpuset;
+        CPU_ZERO(&cpuset);
+        CPU_SET(options.cpuCore, &cpuset);
+        int err = pthread_setaffinity_np(self, sizeof(cpuset), &cpuset);
+        if (err != 0) {
+            logger.log("Thread: Failed to pin '" + options.name + "' to CPU " +
+                       std::to_string(options.cpuCore) + ": " + std::strerror(err));
+            ok = false;
+        }
+    }
+
+    if (options.realtimePriority > 0) {
+        sched_param param{};
+        param.sched_priority = options.realtimePriority;
+        int err = pthread_setschedparam(self, SCHED_FIFO, &param);
+        if (err != 0) {
+            // Usually EPERM: needs root, CAP_SYS_NICE or an rtprio limit
+            logger.log("Thread: Failed to set SCHED_FIFO priority " +
+                       std::to_string(options.realtimePriority) + " for '" +
+                       options.name + "': " + std::strerror(err));
+            ok = false;
+        }
+    }
+
+    return ok;
+}
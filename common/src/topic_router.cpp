@@ -0,0 +1,160 @@
+#include "topic_router.hpp"
+#include <algorithm>
+
+TopicRouter::TopicRouter(size_t cacheCapacity) : cacheCapacity_(cacheCapacity) {}
+
+bool TopicRouter::addRoute(const std::string& filter, Handler handler) {
+    std::vector<std::string> levels = splitLevels(filter);
+    if (!isValidFilter(levels) || !handler) {
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    Node* node = &root_;
+    for (const auto& level : levels) {
+        auto& child = node->children[level];
+        if (!child) {
+            child = std::make_unique<Node>();
+        }
+        node = child.get();
+    }
+
+    node->routes.push_back(handlers_.size());
+    handlers_.push_back(std::make_shared<const Handler>(std::move(handler)));
+
+    // Cached lists may now be missing the new handler
+    cache_.clear();
+    return true;
+}
+
+void TopicRouter::setDefaultHandler(Handler handler) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    defaultHandler_ = handler ? std::make_shared<const Handler>(std::move(handler)) : nullptr;
+}
+
+size_t TopicRouter::dispatch(const std::string& topic, const Json::Value& message) {
+    HandlerList handlers;
+    HandlerPtr fallback;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        handlers = lookupLocked(topic);
+        fallback = defaultHandler_;
+    } // Handlers run without the lock so they may add routes
+
+    if (handlers->empty()) {
+        if (fallback) {
+            (*fallback)(topic, message);
+        }
+        return 0;
+    }
+
+    for (const auto& handler : *handlers) {
+        (*handler)(topic, message);
+    }
+    return handlers->size();
+}
+
+size_t TopicRouter::matchCount(const std::string& topic) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return lookupLocked(topic)->size();
+}
+
+uint64_t TopicRouter::cacheHits() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return cacheHits_;
+}
+
+uint64_t TopicRouter::cacheMisses() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return cacheMisses_;
+}
+
+std::vector<std::string> TopicRouter::splitLevels(const std::string& topic) {
+    std::vector<std::string> levels;
+    size_t start = 0;
+    while (true) {
+        size_t slash = topic.find('/', start);
+        if (slash == std::string::npos) {
+            levels.push_back(topic.substr(start));
+            break;
+        }
+        levels.push_back(topic.substr(start, slash - start));
+        start = slash + 1;
+    }
+    return levels;
+}
+
+bool TopicRouter::isValidFilter(const std::vector<std::string>& levels) {
+    for (size_t i = 0; i < levels.size(); ++i) {
+        const std::string& level = levels[i];
+        bool hasWildcard = level.find_first_of("+#") != std::string::npos;
+
+        if (level == "#") {
+            if (i != levels.size() - 1) {
+                return false; // '#' must be the last level
+            }
+        } else if (level != "+" && hasWildcard) {
+            return false; // Wildcards can't be mixed with text in a level
+        }
+    }
+    return true;
+}
+
+void TopicRouter::matchNode(const Node& node, const std::vector<std::string>& levels,
+                            size_t index, std::vector<size_t>& matches) const {
+    // '#' also matches the parent level ("a/#" matches "a")
+    auto multi = node.children.find("#");
+    if (multi != node.children.end()) {
+        // Wildcards don't match topics starting with '$' at the first level
+        if (index != 0 || levels[0].empty() || levels[0][0] != '$') {
+            matches.insert(matches.end(), multi->second->routes.begin(), multi->second->routes.end());
+        }
+    }
+
+    if (index == levels.size()) {
+        matches.insert(matches.end(), node.routes.begin(), node.routes.end());
+        return;
+    }
+
+    auto exact = node.children.find(levels[index]);
+    if (exact != node.children.end()) {
+        matchNode(*exact->second, levels, index + 1, matches);
+    }
+
+    auto single = node.children.find("+");
+    if (single != node.children.end()) {
+        if (index != 0 || levels[0].empty() || levels[0][0] != '$') {
+            matchNode(*single->second, levels, index + 1, matches);
+        }
+    }
+}
+
+TopicRouter::HandlerList TopicRouter::lookupLocked(const std::string& topic) {
+    auto cached = cache_.find(topic);
+    if (cached != cache_.end()) {
+        cacheHits_++;
+        return cached->second;
+    }
+    cacheMisses_++;
+
+    std::vector<size_t> matches;
+    matchNode(root_, splitLevels(topic), 0, matches);
+
+    // Registration order, independent of where each filter sits in the trie
+    std::sort(matches.begin(), matches.end());
+
+    auto handlers = std::make_shared<std::vector<HandlerPtr>>();
+    handlers->reserve(matches.size());
+    for (size_t routeIndex : matches) {
+        handlers->push_back(handlers_[routeIndex]);
+    }
+
+    // Simple bound: start over when full, hot topics repopulate immediately
+    if (cache_.size() >= cacheCapacity_) {
+        cache_.clear();
+    }
+    HandlerList list = handlers;
+    cache_.emplace(topic, list);
+    return list;
+}
@@ -1,9 +1,14 @@
 #include "logger.hpp"
 #include "mqtt_client.hpp"
-#include "tread_manager.hpp"
+#include "thread_manager.hpp"
+#include "topic_router.hpp"
+#include "telemetry_aggregator.hpp"
+#include "led_animator.hpp"
+#include "change_detector.hpp"
 #include <thread>
 #include <chrono>
 #include <atomic>
+#include <mutex>
 #include <csignal>
 #include <iostream>
 #include <limits>
@@ -19,9 +24,68 @@ static const MQTTConfig MQTT_CONFIG = {
     .topicCommand     = "esp-lection/cmd",
     .topicStatus      = "esp-lection/#",
     .keepAliveInterval = 20,
-    .timeout          = 10000
+    .timeout          = 10000,
+    .cleanSession     = false,
+    .persistenceDir   = "mqtt-persist",          // Relative to the working directory
+    .reconnectMinDelayMs = 250,
+    .reconnectMaxDelayMs = 30000
 };
 
+// Scheduling for the message processor (acks and status on the control path)
+// Set cpuCore to an isolated core (isolcpus=3) and realtimePriority > 0 to
+// run it under SCHED_FIFO; requires root or CAP_SYS_NICE
+static const ThreadOptions PROCESSOR_THREAD_OPTIONS = {
+    .name             = "msg-processor",
+    .cpuCore          = -1,
+    .realtimePriority = 0
+};
+
+// Inbound lanes, indexed by MessageLane
+// While both are backlogged, 8 acknowledgements are served per telemetry sample
+static const std::vector<LaneConfig> MESSAGE_LANES = {
+    {.name = "control",   .weight = 8},
+    {.name = "telemetry", .weight = 1}
+};
+
+// Windowed telemetry summaries republished upstream
+// "10s" is tumbling; "1m_sliding" covers the last minute and is sent every 10 s
+static const AggregationConfig AGGREGATION_CONFIG = {
+    .enabled = true,
+    .topic   = "esp-lection/summary",
+    .fields  = {"temp_bmp", "pressure", "temp_aht", "humidity",
+                "accel_x", "accel_y", "accel_z", "free_heap"},
+    .windows = {
+        {.name = "10s",        .lengthMs = 10000, .hopMs = 10000},
+        {.name = "1m_sliding", .lengthMs = 60000, .hopMs = 10000}
+    }
+};
+
+// Skip repeated ESP32 status payloads at ingest
+// Sensor changes smaller than the deadband count as unchanged
+static const ChangeDetectionConfig CHANGE_DETECTION_CONFIG = {
+    .enabled             = true,
+    .heartbeatIntervalMs = 30000,
+    .deadbands = {
+        {"temp_bmp", 0.2}, {"temp_aht", 0.2}, {"humidity", 0.5}, {"pressure", 0.5},
+        {"accel_x", 0.05}, {"accel_y", 0.05}, {"accel_z", 0.05}, {"free_heap", 1024}
+    },
+    .ignoredFields = {"uptime", "timestamp"}
+};
+
+// LED animation: frames per second per device and the interactive fade length
+static const AnimatorConfig ANIMATOR_CONFIG = {
+    .frameRateHz  = 60,
+    .renderThread = {.name = "led-render"},
+    .sendThread   = {.name = "led-send"}
+};
+static const int64_t FADE_DURATION_MS = 1000;
+
+// Opt-in: send frames and status requests to esp-lection/<device_id>/cmd,
+// addressed to the ESP32 that reported most recently. Off by default, as
+// current firmware only subscribes to MQTT_CONFIG.topicCommand
+static const bool PER_DEVICE_COMMAND_TOPICS = false;
+static const std::string DEVICE_COMMAND_FILTER = "esp-lection/+/cmd";
+
 // Atomic flag for graceful shutdown
 std::atomic<bool> shouldStop(false);
 
@@ -33,60 +97,111 @@ void signalHandler(int signal) {
     }
 }
 
-// Thread: Process messages from queue and display status
-void messageProcessorThread(ThreadSafeQueue<Json::Value>& messageQueue) {
+// Most recent device_id an ESP32 reported, the target of per-device commands
+std::mutex lastDeviceMutex;
+std::string lastDeviceId;
+
+// Animator key of the LED the interactive loop controls: the shared
+// command topic, or the last reporting device (empty until one reports)
+std::string ledTarget() {
+    if (!PER_DEVICE_COMMAND_TOPICS) {
+        return MQTT_CONFIG.topicCommand;
+    }
+    std::lock_guard<std::mutex> lock(lastDeviceMutex);
+    return lastDeviceId;
+}
+
+// Topic that commands for an animator key are published to
+std::string commandTopicFor(const std::string& target) {
+    return PER_DEVICE_COMMAND_TOPICS ? "esp-lection/" + target + "/cmd" : MQTT_CONFIG.topicCommand;
+}
+
+// Handler: ESP32 status/telemetry and command replies
+void handleDeviceMessage(const std::string& topic, const Json::Value& msg) {
+    if (msg["device_id"].isString()) {
+        std::lock_guard<std::mutex> lock(lastDeviceMutex);
+        lastDeviceId = msg["device_id"].asString();
+    }
+
+    if (msg.isMember("heartbeat")) {
+        logger.log("Heartbeat on " + topic + ": state unchanged");
+        return;
+    }
+
+    logger.log("=== ESP32 Message (" + topic + ") ===");
+
+    if (msg.isMember("cmd") && msg["cmd"].isString()) {
+        logger.log("Cmd: " + msg["cmd"].asString());
+    }
+    if (msg.isMember("ok") && msg["ok"].isString()) {
+        logger.log("OK: " + msg["ok"].asString());
+    }
+    if (msg.isMember("error") && msg["error"].isString()) {
+        logger.log("Error: " + msg["error"].asString());
+    }
+
+    if (msg.isMember("led_r") && msg["led_r"].isInt()) {
+        logger.log("LED R: " + std::to_string(msg["led_r"].asInt()));
+    }
+    if (msg.isMember("led_g") && msg["led_g"].isInt()) {
+        logger.log("LED G: " + std::to_string(msg["led_g"].asInt()));
+    }
+    if (msg.isMember("led_b") && msg["led_b"].isInt()) {
+        logger.log("LED B: " + std::to_string(msg["led_b"].asInt()));
+    }
+    if (msg.isMember("led_on")) {
+        logger.log(std::string("LED ON: ") + (msg["led_on"].asBool() ? "true" : "false"));
+    }
+
+    if (msg.isMember("servo_angle") && msg["servo_angle"].isInt()) {
+        logger.log("Servo Angle: " + std::to_string(msg["servo_angle"].asInt()));
+    }
+
+    if (msg.isMember("temp_bmp")) logger.log("Temp BMP: " + std::to_string(msg["temp_bmp"].asFloat()));
+    if (msg.isMember("pressure")) logger.log("Pressure: " + std::to_string(msg["pressure"].asFloat()));
+    if (msg.isMember("temp_aht")) logger.log("Temp AHT: " + std::to_string(msg["temp_aht"].asFloat()));
+    if (msg.isMember("humidity")) logger.log("Humidity: " + std::to_string(msg["humidity"].asFloat()));
+
+    if (msg.isMember("accel_x")) logger.log("Accel X: " + std::to_string(msg["accel_x"].asFloat()));
+    if (msg.isMember("accel_y")) logger.log("Accel Y: " + std::to_string(msg["accel_y"].asFloat()));
+    if (msg.isMember("accel_z")) logger.log("Accel Z: " + std::to_string(msg["accel_z"].asFloat()));
+
+    if (msg.isMember("free_heap")) logger.log("Free heap: " + std::to_string(msg["free_heap"].asUInt()));
+
+    logger.log("=====================");
+}
+
+// Devices identify themselves in the payload; fall back to the topic
+std::string deviceIdOf(const std::string& topic, const Json::Value& msg) {
+    const Json::Value& deviceId = msg["device_id"];
+    return deviceId.isString() ? deviceId.asString() : topic;
+}
+
+// Register per-topic handlers; new device types add their own routes here
+void registerRoutes(TopicRouter& router) {
+    router.addRoute("esp-lection/status", handleDeviceMessage);
+    router.addRoute("esp-lection/+/status", handleDeviceMessage);
+
+    // Anything else under the subscription is decoded as a device message
+    router.setDefaultHandler(handleDeviceMessage);
+}
+
+// Thread: Process messages from queue and dispatch them by topic
+// Samples reach the aggregator (nullptr when disabled) at ingest; this
+// thread only closes windows that ended while no samples arrived
+void messageProcessorThread(MessageQueue& messageQueue, TopicRouter& router,
+                            TelemetryAggregator* aggregator) {
     logger.log("Message Processor Thread started");
 
     while (!shouldStop.load()) {
-        auto message = messageQueue.tryPop();
+        // Wakes as soon as a message arrives; the timeout only bounds how
+        // long shutdown and window flushes wait on an idle queue
+        auto message = messageQueue.waitAndPop(std::chrono::milliseconds(50));
 
         if (message.has_value()) {
-            const Json::Value& msg = message.value();
-
-            logger.log("=== ESP32 Message ===");
-
-            // ESP32 status/telemetry fields
-            if (msg.isMember("cmd") && msg["cmd"].isString()) {
-                logger.log("Cmd: " + msg["cmd"].asString());
-            }
-            if (msg.isMember("ok") && msg["ok"].isString()) {
-                logger.log("OK: " + msg["ok"].asString());
-            }
-            if (msg.isMember("error") && msg["error"].isString()) {
-                logger.log("Error: " + msg["error"].asString());
-            }
-
-            if (msg.isMember("led_r") && msg["led_r"].isInt()) {
-                logger.log("LED R: " + std::to_string(msg["led_r"].asInt()));
-            }
-            if (msg.isMember("led_g") && msg["led_g"].isInt()) {
-                logger.log("LED G: " + std::to_string(msg["led_g"].asInt()));
-            }
-            if (msg.isMember("led_b") && msg["led_b"].isInt()) {
-                logger.log("LED B: " + std::to_string(msg["led_b"].asInt()));
-            }
-            if (msg.isMember("led_on")) {
-                logger.log(std::string("LED ON: ") + (msg["led_on"].asBool() ? "true" : "false"));
-            }
-
-            if (msg.isMember("servo_angle") && msg["servo_angle"].isInt()) {
-                logger.log("Servo Angle: " + std::to_string(msg["servo_angle"].asInt()));
-            }
-
-            if (msg.isMember("temp_bmp")) logger.log("Temp BMP: " + std::to_string(msg["temp_bmp"].asFloat()));
-            if (msg.isMember("pressure")) logger.log("Pressure: " + std::to_string(msg["pressure"].asFloat()));
-            if (msg.isMember("temp_aht")) logger.log("Temp AHT: " + std::to_string(msg["temp_aht"].asFloat()));
-            if (msg.isMember("humidity")) logger.log("Humidity: " + std::to_string(msg["humidity"].asFloat()));
-
-            if (msg.isMember("accel_x")) logger.log("Accel X: " + std::to_string(msg["accel_x"].asFloat()));
-            if (msg.isMember("accel_y")) logger.log("Accel Y: " + std::to_string(msg["accel_y"].asFloat()));
-            if (msg.isMember("accel_z")) logger.log("Accel Z: " + std::to_string(msg["accel_z"].asFloat()));
-
-            if (msg.isMember("free_heap")) logger.log("Free heap: " + std::to_string(msg["free_heap"].asUInt()));
-
-            logger.log("=====================");
-        } else {
-            std::this_thread::sleep_for(std::chrono::milliseconds(50));
+            router.dispatch(message->topic, message->payload);
+        } else if (aggregator) {
+            aggregator->flushDue();
         }
     }
 
@@ -94,10 +209,26 @@ void messageProcessorThread(ThreadSafeQueue<Json::Value>& messageQueue) {
     while (!messageQueue.empty()) {
         auto message = messageQueue.tryPop();
         if (message.has_value()) {
-            logger.log("Final Message: " + message.value().toStyledString());
+            logger.log("Final Message (" + message->topic + "): " + message->payload.toStyledString());
         }
     }
 
+    for (const auto& lane : messageQueue.stats()) {
+        logger.log("Lane " + lane.name +
+                   ": pushed " + std::to_string(lane.pushed) +
+                   ", max depth " + std::to_string(lane.maxDepth) +
+                   ", avg latency " + std::to_string(lane.avgLatencyUs) + " us" +
+                   ", max latency " + std::to_string(lane.maxLatencyUs) + " us");
+    }
+
+    logger.log("Router cache: " + std::to_string(router.cacheHits()) + " hits, " +
+               std::to_string(router.cacheMisses()) + " misses");
+
+    if (aggregator) {
+        logger.log("Aggregator: " + std::to_string(aggregator->samplesAdded()) + " samples, " +
+                   std::to_string(aggregator->messagesPublished()) + " summaries published");
+    }
+
     logger.log("Message Processor Thread stopped");
 }
 
@@ -125,15 +256,7 @@ int getRGBValue(const std::string& colorName) {
 }
 
 // ESP32-compatible command JSON
-Json::Value createLEDCommand(int r, int g, int b) {
-    Json::Value command;
-    command["cmd"] = "led_color";
-    command["r"] = r;
-    command["g"] = g;
-    command["b"] = b;
-    return command;
-}
-
+// led_color / servo_angle commands are generated by LedAnimator
 Json::Value createStatusCommand() {
     Json::Value command;
     command["cmd"] = "status";
@@ -141,13 +264,12 @@ Json::Value createStatusCommand() {
 }
 
 // Main LED control loop for MQTT
-void ledControlLoopMQTT(MQTTClient& mqttClient) {
+// Each entered color fades in from the current one
+void ledControlLoopMQTT(MQTTClient& mqttClient, LedAnimator& animator) {
     logger.log("\n=== LED Control Mode (MQTT) ===");
-    logger.log("Enter RGB values to control the LED");
+    logger.log("Enter RGB values to fade the LED to");
     logger.log("Press Ctrl+C to exit\n");
 
-    const std::string& cmdTopic = mqttClient.getConfig().topicCommand;
-
     while (!shouldStop.load()) {
         std::cout << "\n--- Enter new RGB color ---\n";
 
@@ -160,13 +282,22 @@ void ledControlLoopMQTT(MQTTClient& mqttClient) {
         int b = getRGBValue("Blue");
         if (shouldStop.load()) break;
 
-        Json::Value ledCmd = createLEDCommand(r, g, b);
+        std::string device = ledTarget();
+        if (device.empty()) {
+            logger.log("No ESP32 has reported its device_id yet, color not sent");
+            continue;
+        }
+
+        LedFrame target{.r = r, .g = g, .b = b};
+        animator.play(device, Animation::fade(animator.currentFrame(device), target, FADE_DURATION_MS));
+        logger.log("Fading to new color over " + std::to_string(FADE_DURATION_MS) + " ms");
+
+        // Ask for status once the fade has landed so the reply confirms the new color
+        std::this_thread::sleep_for(std::chrono::milliseconds(FADE_DURATION_MS));
+        if (shouldStop.load()) break;
 
-        if (mqttClient.publishJSON(cmdTopic, ledCmd)) {
-            logger.log("Color command sent successfully!");
-            mqttClient.publishJSON(cmdTopic, createStatusCommand());
-        } else {
-            logger.log("Failed to send color command");
+        if (!mqttClient.publishJSON(commandTopicFor(device), createStatusCommand())) {
+            logger.log("Failed to send status command");
         }
 
         std::cout << "\n";
@@ -178,35 +309,100 @@ int main() {
 
     std::signal(SIGINT, signalHandler);
 
-    ThreadSafeQueue<Json::Value> messageQueue;
-    std::thread processorThread(messageProcessorThread, std::ref(messageQueue));
+    MessageQueue messageQueue(MESSAGE_LANES, LanePolicy::Weighted);
+    TopicRouter router;
+    registerRoutes(router);
 
     logger.log("\n=== MQTT Mode ===");
     logger.log("Broker: " + MQTT_CONFIG.brokerAddress);
     logger.log("Client ID: " + MQTT_CONFIG.clientId);
 
+    ChangeDetector changeDetector(CHANGE_DETECTION_CONFIG);
+
     MQTTClient mqttClient(MQTT_CONFIG, &messageQueue);
+    if (CHANGE_DETECTION_CONFIG.enabled) {
+        mqttClient.setChangeDetector(&changeDetector);
+    }
 
-    if (!mqttClient.connect()) {
-        logger.log("Failed to connect to MQTT broker");
-        shouldStop.store(true);
-        processorThread.join();
-        return 1;
+    // Summaries are published from the MQTT callback and processor threads,
+    // so never block either on a PUBACK round-trip
+    TelemetryAggregator aggregator(AGGREGATION_CONFIG,
+        [&mqttClient](const std::string& topic, const Json::Value& summary) {
+            return mqttClient.publishJSONAsync(topic, summary);
+        });
+
+    // Fed at ingest, ahead of change detection, so summaries count every sample
+    if (AGGREGATION_CONFIG.enabled) {
+        mqttClient.setSampleSink([&aggregator](const std::string& topic, const Json::Value& msg) {
+            aggregator.addSample(deviceIdOf(topic, msg), msg);
+        });
     }
 
-    if (!mqttClient.subscribe(MQTT_CONFIG.topicStatus)) {
-        logger.log("Failed to subscribe to status topic");
+    // Our own summaries come back through the esp-lection/# subscription
+    mqttClient.ignoreInbound(AGGREGATION_CONFIG.topic);
+
+    // Likewise our own commands and animation frames
+    mqttClient.ignoreInbound(MQTT_CONFIG.topicCommand);
+    if (PER_DEVICE_COMMAND_TOPICS) {
+        mqttClient.ignoreInbound(DEVICE_COMMAND_FILTER);
+    }
+
+    // Declared after everything the processor uses, so it is joined first
+    ThreadManager threadManager;
+    threadManager.spawn(PROCESSOR_THREAD_OPTIONS, messageProcessorThread,
+                        std::ref(messageQueue), std::ref(router),
+                        AGGREGATION_CONFIG.enabled ? &aggregator : nullptr);
+
+    // Registered before connecting so it goes out with the connection,
+    // and again automatically after every reconnect; connect() fails if
+    // the broker doesn't grant it
+    mqttClient.subscribe(MQTT_CONFIG.topicStatus);
+
+    if (!mqttClient.connect()) {
+        logger.log("Failed to connect to MQTT broker or subscribe to status topic");
+
+        // A rejected subscription leaves the connection up; stop Paho's callbacks
+        // before the aggregator behind the sample sink is destroyed
         mqttClient.disconnect();
         shouldStop.store(true);
-        processorThread.join();
+        threadManager.joinAll();
         return 1;
     }
 
+    // Frames are ephemeral, so QoS 0 and no per-frame logging
+    LedAnimator animator(ANIMATOR_CONFIG,
+        [&mqttClient](const std::string& deviceId, const Json::Value& command) {
+            return mqttClient.publishJSON(commandTopicFor(deviceId), command, 0, false);
+        });
+    animator.start();
+
     logger.log("MQTT client ready!");
-    ledControlLoopMQTT(mqttClient);
+    ledControlLoopMQTT(mqttClient, animator);
+    animator.stop();
     mqttClient.disconnect();
 
-    processorThread.join();
+    AnimatorStats animatorStats = animator.getStats();
+    logger.log("Animator: " + std::to_string(animatorStats.framesSent) + " frames sent, " +
+               std::to_string(animatorStats.framesDropped) + " coalesced, " +
+               std::to_string(animatorStats.overruns) + " overruns, " +
+               "avg jitter " + std::to_string(animatorStats.avgJitterUs) + " us, " +
+               "max jitter " + std::to_string(animatorStats.maxJitterUs) + " us");
+
+    ChangeStats changeStats = changeDetector.getStats();
+    logger.log("Change detection: " + std::to_string(changeStats.received) + " received, " +
+               std::to_string(changeStats.forwarded) + " forwarded, " +
+               std::to_string(changeStats.heartbeats) + " heartbeats, " +
+               std::to_string(changeStats.suppressedRaw) + " duplicate payloads, " +
+               std::to_string(changeStats.suppressedFields) + " within deadbands (" +
+               std::to_string(static_cast<int>(changeStats.suppressionRatio() * 100)) + "% suppressed)");
+
+    ReconnectStats reconnectStats = mqttClient.getReconnectStats();
+    logger.log("MQTT outages: " + std::to_string(reconnectStats.outages) +
+               ", recovered: " + std::to_string(reconnectStats.recoveries) +
+               ", avg recovery " + std::to_string(reconnectStats.avgRecoveryMs) + " ms" +
+               ", max recovery " + std::to_string(reconnectStats.maxRecoveryMs) + " ms");
+
+    threadManager.joinAll();
     logger.log("Application shutdown complete");
     return 0;
 }
\ No newline at end of file